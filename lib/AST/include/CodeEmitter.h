@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ASTVisitor.h"
+
+#include <vector>
+
+/**
+ * Emits a C++ expression that evaluates the visited expression tree the way
+ * ExpressionResolver does, to an ElementSptr.
+ * Used by the gamecompiler tool to compile the expressions of a game into generated source.
+ *
+ * Operators yielding a bool or an int are emitted as plain C++ values, only wrapped into
+ * an element where one is needed, so e.g. a case condition compiles to a bool expression.
+ *
+ * The emitted expression refers to the `CompiledContext& context` and `ElementMap& game_state`
+ * of a compiled rule (see compiledRules.h). A list is referred to as an element of
+ * context.lists, boundLists() names the list at each index so that the game can bind them
+ * as ExpressionTree::build() does when interpreting.
+ */
+class CodeEmitter : public ASTVisitor {
+public:
+
+    void visit(ASTNode& node, ElementMap& elements) override;
+
+    void visit(NameNode& name, ElementMap& elements) override;
+
+    void visit(NumberNode& numNode, ElementMap& elements) override;
+
+    void visit(ListNode& listNode, ElementMap& elements) override;
+
+    void visit(PlayersNode& playersNode, ElementMap& elements) override;
+
+    void visit(UnaryOperator& uOp, ElementMap& elements) override;
+
+    void visit(BinaryOperator& bOp, ElementMap& elements) override;
+
+    void visit(TernaryOperator& tOp, ElementMap& elements) override;
+
+    // the result as an ElementSptr, or as what getBool()/getInt() of that element would return
+    std::string getResult();
+    std::string getBool();
+    std::string getInt();
+
+    const std::vector<std::string>& boundLists();
+
+    /**
+     * Returns str as a quoted and escaped C++ string literal
+     */
+    static std::string quote(const std::string& str);
+
+private:
+    enum class Kind {
+        Element,
+        Bool,
+        Int,
+    };
+
+    void setResult(Kind kind, std::string code);
+
+    std::string result;
+    Kind kind = Kind::Element;
+    std::vector<std::string> lists;
+};
@@ -2,6 +2,12 @@
 #include "ASTVisitor.h"
 #include <algorithm>
 
+/**
+ * Finds the list named token in the game state, either as a top level list
+ * (eg. constants) or as an element of one (eg. weapons). Returns nullptr if not found.
+ */
+ElementSptr inGameState(std::string token, ElementMap& gameState);
+
 class ExpressionTree{
 public:
     enum nodeType{
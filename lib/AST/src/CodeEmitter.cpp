@@ -0,0 +1,111 @@
+#include "CodeEmitter.h"
+#include <algorithm>
+#include <cassert>
+
+std::string CodeEmitter::getResult() {
+    switch (kind) {
+        case Kind::Bool: return "std::make_shared<Element<bool>>(" + result + ")";
+        case Kind::Int: return "std::make_shared<Element<int>>(" + result + ")";
+        case Kind::Element: break;
+    }
+    return result;
+}
+
+std::string CodeEmitter::getBool() {
+    return kind == Kind::Bool ? result : getResult() + "->getBool()";
+}
+
+std::string CodeEmitter::getInt() {
+    return kind == Kind::Int ? result : getResult() + "->getInt()";
+}
+
+void CodeEmitter::setResult(Kind kind, std::string code) {
+    this->kind = kind;
+    result = std::move(code);
+}
+
+const std::vector<std::string>& CodeEmitter::boundLists() { return lists; }
+
+std::string CodeEmitter::quote(const std::string& str) {
+    std::string quoted = "\"";
+    for (char c : str) {
+        switch (c) {
+            case '"':  quoted += "\\\""; break;
+            case '\\': quoted += "\\\\"; break;
+            case '\n': quoted += "\\n";  break;
+            case '\t': quoted += "\\t";  break;
+            default:   quoted += c;      break;
+        }
+    }
+    return quoted + "\"";
+}
+
+void CodeEmitter::visit(ASTNode& node, ElementMap& elements) {
+    assert(false && "Invalid node during code emission");
+}
+
+void CodeEmitter::visit(NameNode& nameNode, ElementMap& elements) {
+    setResult(Kind::Element, "resolveName(game_state, " + quote(nameNode.name) + ")");
+}
+
+void CodeEmitter::visit(NumberNode& numNode, ElementMap& elements) {
+    setResult(Kind::Int, std::to_string(numNode.num));
+}
+
+void CodeEmitter::visit(ListNode& listNode, ElementMap& elements) {
+    // lists of the same name are bound to the same list
+    auto list = std::find(lists.begin(), lists.end(), listNode.nameOfList);
+    if (list == lists.end()) {
+        list = lists.insert(list, listNode.nameOfList);
+    }
+    setResult(Kind::Element, "context.lists[" + std::to_string(list - lists.begin()) + "]");
+}
+
+void CodeEmitter::visit(PlayersNode& playersNode, ElementMap& elements) {
+    setResult(Kind::Element, "allPlayers(*context.players)");
+}
+
+void CodeEmitter::visit(UnaryOperator& uOp, ElementMap& elements) {
+    uOp.operand->accept(*this, elements);
+    if (uOp.kind == "!")
+        setResult(Kind::Bool, "!" + getBool());
+    else if (uOp.kind == "size")
+        setResult(Kind::Int, getResult() + "->getSizeAsInt()");
+}
+
+void CodeEmitter::visit(BinaryOperator& bOp, ElementMap& elements) {
+    bOp.left->accept(*this, elements);
+    std::string left = getResult();
+
+    if (bOp.kind == ".") {
+        // the rhs of '.' is only used for its name, see ExpressionResolver
+        setResult(Kind::Element, "member(" + left + ", " + quote(bOp.right->getName()) + ")");
+        return;
+    }
+
+    bOp.right->accept(*this, elements);
+
+    if (bOp.kind == "upfrom")
+        setResult(Kind::Element, left + "->upfrom(" + getInt() + ")");
+    else if (bOp.kind == "contains")
+        setResult(Kind::Bool, left + "->contains(" + getResult() + ")");
+    else if (bOp.kind == "==" || bOp.kind == "!=" || bOp.kind == ">" ||
+             bOp.kind == "<" || bOp.kind == "<=" || bOp.kind == ">=")
+        setResult(Kind::Bool, "(compare(" + left + ", " + getResult() + ") " + bOp.kind + " 0)");
+}
+
+void CodeEmitter::visit(TernaryOperator& tOp, ElementMap& elements) {
+    if (tOp.kind == "collect") {
+        tOp.left->accept(*this, elements);
+        std::string left = getResult();
+        tOp.right->accept(*this, elements);
+        std::string condition = getBool();
+
+        // middle node should always be string and not found in elementMap
+        setResult(Kind::Element, "[&] { ElementVector collection; ElementSptr list = " + left + "; "
+            "for (auto& element : list->getVector()) { "
+            "game_state[" + quote(tOp.middle->getName()) + "] = element; "
+            "if (" + condition + ") collection.emplace_back(element); } "
+            "return ElementSptr(std::make_shared<Element<ElementVector>>(collection)); }()");
+    }
+}
@@ -27,7 +27,8 @@ public:
 
     /**
      * Handles any lost users that didn't disconenct properly 
-     * calls commands *leave*, *exit*, & *end* artficially as required
+     * removes them all in one batch, ending or updating each affected game once
+     * (see GlobalServerState::disconnectUsers())
      * NOTE: clears the users vector after its done
      */
     std::deque<Message> handleLostUsers(std::vector<User> &users); 
@@ -36,21 +37,18 @@ private:
     GlobalServerState &globalState;
     std::deque<Message> outgoing;
     std::unordered_map<UserCommand, commandPointer> commandMap;      // Maps command names to command objects
-    std::unordered_map<CommandResult, std::string> commandResultMap; // Maps command results to feedback strings
+    std::unordered_map<CommandResult, Payload> commandResultMap;     // Maps command results to feedback, built once and shared by every response
+    std::array<Histogram*, UserCommand::QUEUE + 1> commandDurations; // Time taken by each command, see GlobalServerState::metrics()
 
     void initializeMaps();
     void initializeCommandMap();
     void initializeCommandResultMap();
+    void initializeCommandMetrics();
     void registerCommandImpl();
 
     /**
      * Main function responsible for handling execution of a single command type.
      * Calls the execute method of command object in the commandMap
      */
-    CommandResult executeCommand(ProcessedMessage &processedMessage);
-
-    /**
-     * Boradcast lobby message to all users in lobby
-     */
-    void broadcastLobbyMessage(ProcessedMessage &processedMessage);
+    CommandResult executeCommand(const ProcessedMessage &processedMessage);
 };
\ No newline at end of file
@@ -22,6 +22,7 @@ enum class CommandResult {
     ERROR_OWNER_CANNOT_JOIN_FROM_SAME_DEVICE,
     ERROR_INVALID_COMMAND,
     ERROR_NO_USERNAME,
+    ERROR_INVALID_ROOM_NAME,
 
     SUCCESS,
     SUCCESS_GAME_CREATION,
@@ -58,7 +59,7 @@ public:
         : globalState(globalState), outgoing(outgoing) 
     {}
     virtual ~Command() = default;
-    virtual CommandResult execute(ProcessedMessage &) = 0;
+    virtual CommandResult execute(const ProcessedMessage &) = 0;
 
 protected:
     GlobalServerState &globalState;
@@ -82,7 +83,7 @@ class CreateGameCommand : public Command {
 public:
     CreateGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /**
@@ -92,7 +93,7 @@ class ListGamesCommand : public Command {
 public:
     ListGamesCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /**
@@ -103,7 +104,7 @@ class ListHelpCommand : public Command {
 public:
     ListHelpCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /**
@@ -119,7 +120,36 @@ class JoinGameCommand : public Command {
 public:
     JoinGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
+};
+
+/**
+ * Moves the user to the lobby room given as argument, creating the room if needed.
+ * Without an argument, lists the rooms and the room the user is in.
+ *
+ * Returns an error if:
+ *      - User is in a game
+ */
+class RoomCommand : public Command {
+public:
+    RoomCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
+        : Command(globalState, outgoing) {}
+    CommandResult execute(const ProcessedMessage &) override;
+};
+
+/**
+ * Queues the user for a game of the type with the index given as argument.
+ * The game is created and started once enough users are queued for it (see Matchmaker).
+ *
+ * Returns an error if:
+ *      - User is in a game
+ *      - No game index is given or the index is invalid
+ */
+class QueueGameCommand : public Command {
+public:
+    QueueGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
+        : Command(globalState, outgoing) {}
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /////////////////////       IN GAME COMMANDS - OWNER      /////////////////////
@@ -136,7 +166,7 @@ class StartGameCommand : public Command {
 public:
     StartGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /**
@@ -150,7 +180,7 @@ class EndGameCommand : public Command {
 public:
     EndGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 /////////////////////       IN GAME COMMANDS - PLAYER      /////////////////////
@@ -166,7 +196,7 @@ class LeaveGameCommand : public Command {
 public:
     LeaveGameCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
 
 
@@ -188,11 +218,11 @@ class ExitServerCommand : public Command {
 public:
     ExitServerCommand(GlobalServerState &globalState, std::deque<Message> &outgoing)
         : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 
 private:
-    CommandResult executePlayerImpl(ProcessedMessage &);
-    CommandResult executeOwnerImpl(ProcessedMessage &);
+    CommandResult executePlayerImpl(const ProcessedMessage &);
+    CommandResult executeOwnerImpl(const ProcessedMessage &);
 };
 
 /**
@@ -209,5 +239,5 @@ class UserNameCommand : public Command {
     UserNameCommand(GlobalServerState &globalState,
     std::deque<Message> &outgoing)
     : Command(globalState, outgoing) {}
-    CommandResult execute(ProcessedMessage &) override;
+    CommandResult execute(const ProcessedMessage &) override;
 };
\ No newline at end of file
@@ -2,10 +2,9 @@
 
 #include "server.h"
 
-#include <algorithm>
-#include <sstream>
-#include <unordered_map>
-#include <vector>
+#include <array>
+#include <optional>
+#include <string_view>
 
 /**
  * Possible commands that a user may enter
@@ -20,6 +19,120 @@ enum UserCommand {
     LEAVE,
     END,
     USERNAME,
+    ROOM,
+    QUEUE,
+};
+
+/////////////////////       COMMAND WORDS       /////////////////////
+
+struct CommandWord {
+    std::string_view word;
+    UserCommand command;
+};
+
+constexpr CommandWord COMMAND_WORDS[] = {
+    { "exit", UserCommand::EXIT },
+    { "help", UserCommand::HELP },
+    { "games", UserCommand::GAMES },
+    { "create", UserCommand::CREATE },
+    { "join", UserCommand::JOIN },
+    { "start", UserCommand::START },
+    { "leave", UserCommand::LEAVE },
+    { "end", UserCommand::END },
+    { "name", UserCommand::USERNAME },
+    { "room", UserCommand::ROOM },
+    { "queue", UserCommand::QUEUE },
+};
+
+/**
+ * A perfect hash of the command words: every word in COMMAND_WORDS lands in its own slot of
+ * COMMAND_TABLE (checked at compile time), so a lookup is one hash and one comparison.
+ * NOTE: adding a command word may require new multipliers
+ */
+constexpr size_t COMMAND_TABLE_SIZE = 16;
+
+constexpr size_t commandHash(std::string_view word) {
+    return (word.size() + 3 * static_cast<unsigned char>(word.front())
+                        + 2 * static_cast<unsigned char>(word.back())) % COMMAND_TABLE_SIZE;
+}
+
+using CommandTable = std::array<const CommandWord*, COMMAND_TABLE_SIZE>;
+
+constexpr CommandTable buildCommandTable() {
+    CommandTable table{};
+    for (const CommandWord& commandWord : COMMAND_WORDS) {
+        table[commandHash(commandWord.word)] = &commandWord;
+    }
+    return table;
+}
+
+constexpr CommandTable COMMAND_TABLE = buildCommandTable();
+
+constexpr bool commandTableIsPerfect() {
+    for (const CommandWord& commandWord : COMMAND_WORDS) {
+        if (COMMAND_TABLE[commandHash(commandWord.word)] != &commandWord) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(commandTableIsPerfect(), "command words collide in COMMAND_TABLE, change commandHash");
+
+/**
+ * The command of each CommandCode of the binary protocol, in CommandCode order
+ */
+constexpr UserCommand COMMAND_CODES[] = {
+    UserCommand::EXIT,
+    UserCommand::HELP,
+    UserCommand::GAMES,
+    UserCommand::CREATE,
+    UserCommand::JOIN,
+    UserCommand::START,
+    UserCommand::LEAVE,
+    UserCommand::END,
+    UserCommand::USERNAME,
+    UserCommand::ROOM,
+    UserCommand::QUEUE,
+};
+static_assert(std::size(COMMAND_CODES) == static_cast<size_t>(CommandCode::Queue) + 1,
+              "every CommandCode needs a command");
+
+constexpr std::optional<UserCommand> lookupCommand(std::string_view word) {
+    if (word.empty()) {
+        return std::nullopt;
+    }
+    const CommandWord* commandWord = COMMAND_TABLE[commandHash(word)];
+    if (commandWord == nullptr || commandWord->word != word) {
+        return std::nullopt;
+    }
+    return commandWord->command;
+}
+
+/////////////////////       PROCESSED MESSAGES       /////////////////////
+
+/**
+ * The whitespace separated tokens that follow a command word.
+ * Holds up to MAX_ARGUMENTS tokens inline, any further tokens are ignored.
+ */
+class CommandArguments {
+public:
+    static constexpr size_t MAX_ARGUMENTS = 8;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    std::string_view operator[](size_t index) const { return tokens[index]; }
+    const std::string_view* begin() const { return tokens.data(); }
+    const std::string_view* end() const { return tokens.data() + count; }
+
+    void push_back(std::string_view token) {
+        if (count < MAX_ARGUMENTS) {
+            tokens[count++] = token;
+        }
+    }
+
+private:
+    std::array<std::string_view, MAX_ARGUMENTS> tokens;
+    size_t count = 0;
 };
 
 /**
@@ -29,31 +142,44 @@ enum UserCommand {
  * - commandType : Type of command (by default a INPUT)
  * - Arguments : The arguments provided for that particular command as tokens
  * - input : IF NOT COMMAND, the message text 
+ * - choice : IF NOT COMMAND, the option a binary protocol client chose, sent instead of input
+ * - malformed : the message was a binary protocol frame that could not be decoded
+ * NOTE: arguments and input borrow from the text of the Message that was processed,
+ * which must outlive the ProcessedMessage
  */
 struct ProcessedMessage {
     bool isCommand = false;
     User user;
     UserCommand commandType;
-    std::vector<std::string> arguments;
-    std::string input;
+    CommandArguments arguments;
+    std::string_view input;
+    std::optional<uint32_t> choice;
+    bool malformed = false;
 };
 
 /**
  * Message Processor interface manipulates the text strings contained in the messages and maps
  * them to respective UserCommand enums for further use by command handler.
- * It also separates the arguments provided by storing them as a vector of string tokens.
+ * It also separates the arguments provided by storing them as tokens viewing the message text,
+ * so processing a message never allocates.
+ * Messages of the binary protocol are decoded rather than tokenised, every frame of such a
+ * message becomes its own ProcessedMessage (see Opcode).
  */
 class MessageProcessor {
 public:
-    MessageProcessor() { initializeCommandStringMap(); };
-    ~MessageProcessor(){};
-
     std::deque<ProcessedMessage> getProcessedMessages(const std::deque<Message> &incoming);
 
-private:
+    /**
+     * Processes the text of a message, or the first frame of a binary protocol message
+     */
     ProcessedMessage createProcessedMessage(const Message &message);
-    std::vector<std::string> tokenizeMessage(const std::string &text);
-    void initializeCommandStringMap();
 
-    std::unordered_map<std::string, UserCommand> CommandStringMap;
+private:
+    ProcessedMessage decodeFrame(User user, Opcode opcode, std::string_view fields);
+
+    /**
+     * Returns the first whitespace separated token of text and advances text past it.
+     * Returns an empty token once text has no tokens left.
+     */
+    std::string_view nextToken(std::string_view &text);
 };
\ No newline at end of file
@@ -3,62 +3,72 @@
 void CommandHandler::initializeMaps() {
     initializeCommandMap();
     initializeCommandResultMap();
+    initializeCommandMetrics();
 }
 
 std::deque<Message>
 CommandHandler::getOutgoingMessages(const std::deque<ProcessedMessage> &incomingProcessedMessages) {
     outgoing.clear();
 
-    for (auto processedMessage : incomingProcessedMessages) {
+    for (const auto& processedMessage : incomingProcessedMessages) {
         User user = processedMessage.user;
 
+        if (processedMessage.malformed) {
+            outgoing.push_back({user, {}, commandResultMap[CommandResult::ERROR_INCORRECT_COMMAND_FORMAT]});
+            continue;
+        }
         if (processedMessage.isCommand) {
             CommandResult commandResult = executeCommand(processedMessage);
             if (commandResult != CommandResult::SUCCESS) {
-                outgoing.push_back({user, commandResultMap[commandResult]});
+                outgoing.push_back({user, {}, commandResultMap[commandResult]});
             }
-        } else {
-            if (globalState.isInGame(user)) {
-                globalState.registerUserGameInput(user, processedMessage.input);
-            } else if(globalState.isInLobby(user)) {
-                broadcastLobbyMessage(processedMessage);
+            continue;
+        }
+
+        using Session = GlobalServerState::Session;
+        const Session* session = globalState.getSession(user);
+        Session::Location location = session != nullptr ? session->location : Session::Connected;
+        if (location == Session::InGame) {
+            if (processedMessage.choice) {
+                globalState.registerUserGameInput(user, *processedMessage.choice);
             } else {
-                outgoing.push_back({user, commandResultMap[CommandResult::ERROR_NO_USERNAME]});
+                globalState.registerUserGameInput(user, std::string(processedMessage.input));
             }
+        } else if (processedMessage.choice) {
+            outgoing.push_back({user, {}, commandResultMap[CommandResult::ERROR_INVALID_COMMAND]});
+        } else if (location == Session::InLobby) {
+            globalState.publishLobbyMessage(user, processedMessage.input);
+        } else {
+            outgoing.push_back({user, {}, commandResultMap[CommandResult::ERROR_NO_USERNAME]});
         }
     }
-    return outgoing;
+    // the lobby chat lines of this batch go out together as one digest
+    globalState.buildLobbyDigest(outgoing);
+
+    // the commands append to outgoing, hand its messages over instead of copying them
+    return std::move(outgoing);
 }
 
 std::deque<Message> 
 CommandHandler::handleLostUsers(std::vector<User> &users) {
     outgoing.clear();
-    for (auto user: users) {
-        ProcessedMessage processedMessage{true, user, UserCommand::EXIT, std::vector<std::string>{}, ""};
-        executeCommand(processedMessage);
-    }
+    globalState.disconnectUsers(users, outgoing);
     users.clear();
-    return outgoing;
+    return std::move(outgoing);
 }
 
 CommandResult
-CommandHandler::executeCommand(ProcessedMessage &processedMessage) {
+CommandHandler::executeCommand(const ProcessedMessage &processedMessage) {
+    ScopedTimer timer{*commandDurations[processedMessage.commandType]};
 
-    if (processedMessage.commandType != UserCommand::USERNAME && globalState.getName(processedMessage.user) == "error") {
+    const GlobalServerState::Session* session = globalState.getSession(processedMessage.user);
+    if (processedMessage.commandType != UserCommand::USERNAME && (session == nullptr || session->name.empty())) {
         return CommandResult::ERROR_NO_USERNAME;    // TODO: Fix this into more informative message
     }
 
     return commandMap[processedMessage.commandType]->execute(processedMessage);
 }
 
-void CommandHandler::broadcastLobbyMessage(ProcessedMessage &processedMessage) {
-    std::stringstream outgoingText;
-    outgoingText << globalState.getName(processedMessage.user) << " : " << processedMessage.input << "\n";
-
-    std::deque<Message> messages = globalState.buildMessagesForServerLobby(outgoingText.str());
-    outgoing.insert(outgoing.end(), messages.begin(), messages.end());
-}
-
 void CommandHandler::registerCommand(UserCommand userCommand, commandPointer commandPointer) {
     commandMap[userCommand] = std::move(commandPointer);
 }
@@ -73,42 +83,56 @@ void CommandHandler::initializeCommandMap() {
     registerCommand(UserCommand::GAMES, std::make_unique<ListGamesCommand>(globalState, outgoing));
     registerCommand(UserCommand::EXIT, std::make_unique<ExitServerCommand>(globalState, outgoing));
     registerCommand(UserCommand::USERNAME, std::make_unique<UserNameCommand>(globalState, outgoing));
+    registerCommand(UserCommand::ROOM, std::make_unique<RoomCommand>(globalState, outgoing));
+    registerCommand(UserCommand::QUEUE, std::make_unique<QueueGameCommand>(globalState, outgoing));
+}
+
+void CommandHandler::initializeCommandMetrics() {
+    for (const CommandWord& commandWord : COMMAND_WORDS) {
+        commandDurations[commandWord.command] = &globalState.metrics().histogram(
+            "socialgaming_command_duration_seconds", "Time taken to execute a command, by command.", 1e-6,
+            "command=\"" + std::string(commandWord.word) + "\"");
+    }
 }
 
 void CommandHandler::initializeCommandResultMap() {
-    commandResultMap[CommandResult::ERROR_INCORRECT_COMMAND_FORMAT] = "Incorrect Command Format.\nPlease enter: <command> <arguments>. To list all commands, enter: help\n\n";
-    commandResultMap[CommandResult::ERROR_INVALID_GAME_INDEX] = "Invalid Game Index.\nTo list all available games, enter: games\n\n";
-    commandResultMap[CommandResult::ERROR_INVALID_INVITATION_CODE] = "Invalid invitation code entered: No game found.\n\n";
-    commandResultMap[CommandResult::ERROR_GAME_HAS_STARTED] = "The game has already started.\n\n";
-    commandResultMap[CommandResult::ERROR_NOT_AN_OWNER] = "Only an owner can start or end the game.\n\n";
-    commandResultMap[CommandResult::ERROR_OWNER_CANNOT_LEAVE] = "Owner cannot leave their game. To end game for all players, enter : end\n\n";
-    commandResultMap[CommandResult::ERROR_OWNER_CANNOT_JOIN_FROM_SAME_DEVICE] = "Owner cannot join the game from same window. Please open up a new window to join the game!\n\n";
-    commandResultMap[CommandResult::ERROR_INVALID_COMMAND] = "Invalid Command!\n\n";
-    commandResultMap[CommandResult::ERROR_GAME_NOT_STARTED] = "The game has not been started yet!\n\n";
-    commandResultMap[CommandResult::ERROR_NOT_ENOUGH_PLAYERS] = "Game cannot be started, more players needed!\n\n";
-    commandResultMap[CommandResult::ERROR_NO_USERNAME] = "To proceed, enter: name <your game name>\n\n";
-
-    commandResultMap[CommandResult::SUCCESS_GAME_CREATION] = "Game Successfully Created with invitation Code : \nPlease enter \"start\" to start the game.\n\n";
-    commandResultMap[CommandResult::SUCCESS_GAME_JOIN] = "Game successfully joined. Waiting for the owner to start\n\n";
-    commandResultMap[CommandResult::SUCCESS_GAME_START] = "Game Started!\n\n";
-    commandResultMap[CommandResult::SUCCESS_GAME_END] = "Game Ended. All players have been moved to server lobby.\n\n";
-    commandResultMap[CommandResult::SUCCESS_GAME_LEAVE] = "Game Successfully left.\n\n";
-    commandResultMap[CommandResult::SUCCESS_USERNAME] = "Name Successfully assigned.\n\n";
-
-    commandResultMap[CommandResult::STRING_SERVER_HELP] =
+    commandResultMap[CommandResult::ERROR_INCORRECT_COMMAND_FORMAT] = makePayload("Incorrect Command Format.\nPlease enter: <command> <arguments>. To list all commands, enter: help\n\n");
+    commandResultMap[CommandResult::ERROR_INVALID_GAME_INDEX] = makePayload("Invalid Game Index.\nTo list all available games, enter: games\n\n");
+    commandResultMap[CommandResult::ERROR_INVALID_INVITATION_CODE] = makePayload("Invalid invitation code entered: No game found.\n\n");
+    commandResultMap[CommandResult::ERROR_GAME_HAS_STARTED] = makePayload("The game has already started.\n\n");
+    commandResultMap[CommandResult::ERROR_NOT_AN_OWNER] = makePayload("Only an owner can start or end the game.\n\n");
+    commandResultMap[CommandResult::ERROR_OWNER_CANNOT_LEAVE] = makePayload("Owner cannot leave their game. To end game for all players, enter : end\n\n");
+    commandResultMap[CommandResult::ERROR_OWNER_CANNOT_JOIN_FROM_SAME_DEVICE] = makePayload("Owner cannot join the game from same window. Please open up a new window to join the game!\n\n");
+    commandResultMap[CommandResult::ERROR_INVALID_COMMAND] = makePayload("Invalid Command!\n\n");
+    commandResultMap[CommandResult::ERROR_GAME_NOT_STARTED] = makePayload("The game has not been started yet!\n\n");
+    commandResultMap[CommandResult::ERROR_NOT_ENOUGH_PLAYERS] = makePayload("Game cannot be started, more players needed!\n\n");
+    commandResultMap[CommandResult::ERROR_NO_USERNAME] = makePayload("To proceed, enter: name <your game name>\n\n");
+    commandResultMap[CommandResult::ERROR_INVALID_ROOM_NAME] = makePayload("Invalid room name, it is too long.\n\n");
+
+    commandResultMap[CommandResult::SUCCESS_GAME_CREATION] = makePayload("Game Successfully Created with invitation Code : \nPlease enter \"start\" to start the game.\n\n");
+    commandResultMap[CommandResult::SUCCESS_GAME_JOIN] = makePayload("Game successfully joined. Waiting for the owner to start\n\n");
+    commandResultMap[CommandResult::SUCCESS_GAME_START] = makePayload("Game Started!\n\n");
+    commandResultMap[CommandResult::SUCCESS_GAME_END] = makePayload("Game Ended. All players have been moved to server lobby.\n\n");
+    commandResultMap[CommandResult::SUCCESS_GAME_LEAVE] = makePayload("Game Successfully left.\n\n");
+    commandResultMap[CommandResult::SUCCESS_USERNAME] = makePayload("Name Successfully assigned.\n\n");
+
+    commandResultMap[CommandResult::STRING_SERVER_HELP] = makePayload(
         "\n"
         "  * To view the available games enter: games\n"
         "  * To create a new game from the options enter: create <game_index>\n"
         "  * To join a game with an invitation code enter: join <invitation_code>\n"
+        "  * To be matched with other players for a game enter: queue <game_index>\n"
+        "  * To chat in another lobby room enter: room <room_name>\n"
+        "  * To list the lobby rooms enter: room\n"
         "  * To exit the server enter: exit\n"
-        "  * To display help information again enter: help\n\n";
-    commandResultMap[CommandResult::STRING_INGAME_PLAYER_HELP] =
+        "  * To display help information again enter: help\n\n");
+    commandResultMap[CommandResult::STRING_INGAME_PLAYER_HELP] = makePayload(
         "\n"
         "  * To leave the game enter: leave\n"
-        "  * To exit the server enter: exit\n\n";
-    commandResultMap[CommandResult::STRING_INGAME_OWNER_HELP] =
+        "  * To exit the server enter: exit\n\n");
+    commandResultMap[CommandResult::STRING_INGAME_OWNER_HELP] = makePayload(
         "\n"
         "  * To start the game enter: start\n"
         "  * To end the game enter: end\n"
-        "  * To exit the server enter: exit\n\n";
+        "  * To exit the server enter: exit\n\n");
 }
\ No newline at end of file
@@ -1,15 +1,22 @@
 #include "commands.h"
+#include "gameEvents.h"
+
+#include <charconv>
 
 ////////////////////////////////////////////////////////////////////////////
 ////////////////////////      HELPER FUNCTIONS      ////////////////////////
 
+// parses the leading digits of token into value, returns false if there are none
+template <typename T>
+bool parseNumber(std::string_view token, T& value) {
+    auto [end, errorCode] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return errorCode == std::errc();
+}
+
 void handlePlayerLeave(GlobalServerState& globalState, std::deque<Message>& outgoing, User user) {
     std::stringstream notification;
     notification << "\n" << globalState.getName(user) << " left\n\n" ; 
-    std::deque<Message> messages = globalState.buildMsgsForOtherPlayers(notification.str(), user);
-    for (auto message : messages) {
-        outgoing.push_back(message);
-    }
+    globalState.buildMsgsForOtherPlayers(notification.str(), user, outgoing);
     
     User owner = globalState.getGameOwner(user);
     int playerCount = globalState.getPlayerCount(user);
@@ -19,10 +26,8 @@ void handlePlayerLeave(GlobalServerState& globalState, std::deque<Message>& outg
     
 
     if (globalState.isOngoingGame(owner) && !globalState.gameHasEnoughPlayers(owner)) {
-        std::deque<Message> messages = globalState.buildMsgsForAllPlayersAndOwner("\nNot enough players left, ending game.\n\n", owner);
-        for (auto message : messages) {
-            outgoing.push_back(message);
-        }
+        globalState.buildMsgsForAllPlayersAndOwner("\nNot enough players left, ending game.\n\n", owner, outgoing,
+            gameStateEvent(GameStateChange::Ended, globalState.getGameID(owner)));
         globalState.endGame(owner);
     } else {
         notification << "Player Count : " << playerCount - 1 << "\n\n";
@@ -35,7 +40,7 @@ void handlePlayerLeave(GlobalServerState& globalState, std::deque<Message>& outg
 
 //////////////////////////      CREATE GAME      ///////////////////////////
 
-CommandResult CreateGameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult CreateGameCommand::execute(const ProcessedMessage &processedMessage) {
     if (globalState.isInGame(processedMessage.user)) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
@@ -44,9 +49,7 @@ CommandResult CreateGameCommand::execute(ProcessedMessage &processedMessage) {
     }
 
     int gameIndex;
-    try {
-        gameIndex = stoi(processedMessage.arguments[0]);
-    } catch (std::exception &e) {
+    if (!parseNumber(processedMessage.arguments[0], gameIndex)) {
         return CommandResult::ERROR_INVALID_GAME_INDEX;
     }
 
@@ -64,7 +67,7 @@ CommandResult CreateGameCommand::execute(ProcessedMessage &processedMessage) {
 }
 
 //////////////////////////      LIST GAMES      //////////////////////////
-CommandResult ListGamesCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult ListGamesCommand::execute(const ProcessedMessage &processedMessage) {
     if (globalState.isInGame(processedMessage.user)) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
@@ -74,7 +77,7 @@ CommandResult ListGamesCommand::execute(ProcessedMessage &processedMessage) {
 
 //////////////////////////      HELP      //////////////////////////
 
-CommandResult ListHelpCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult ListHelpCommand::execute(const ProcessedMessage &processedMessage) {
     if (globalState.isOwner(processedMessage.user)) {
         return CommandResult::STRING_INGAME_OWNER_HELP;
     }
@@ -86,7 +89,7 @@ CommandResult ListHelpCommand::execute(ProcessedMessage &processedMessage) {
 
 //////////////////////////      JOIN GAME      //////////////////////////
 
-CommandResult JoinGameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult JoinGameCommand::execute(const ProcessedMessage &processedMessage) {
     if (processedMessage.arguments.empty()) {
         return CommandResult::ERROR_INCORRECT_COMMAND_FORMAT;
     }
@@ -97,8 +100,9 @@ CommandResult JoinGameCommand::execute(ProcessedMessage &processedMessage) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
 
-    int invitationCode = stoi(processedMessage.arguments[0]);
-    if (!globalState.isValidGameInvitation(invitationCode)) {
+    uintptr_t invitationCode;
+    if (!parseNumber(processedMessage.arguments[0], invitationCode)
+            || !globalState.isValidGameInvitation(invitationCode)) {
         return CommandResult::ERROR_INVALID_INVITATION_CODE;
     }
     if (globalState.isOngoingGame(invitationCode)) {
@@ -111,10 +115,7 @@ CommandResult JoinGameCommand::execute(ProcessedMessage &processedMessage) {
     std::stringstream notification;
     notification << "\n" << globalState.getName(processedMessage.user) << " joined the game!\n\n";
 
-    std::deque<Message> messages = globalState.buildMsgsForOtherPlayers(notification.str(), processedMessage.user);
-    for (auto message : messages) {
-        outgoing.push_back(message);
-    }
+    globalState.buildMsgsForOtherPlayers(notification.str(), processedMessage.user, outgoing);
 
     notification << "Player Count : " << playerCount << "\n\n";
     outgoing.push_back({globalState.getGameOwner(processedMessage.user), notification.str()});
@@ -122,11 +123,57 @@ CommandResult JoinGameCommand::execute(ProcessedMessage &processedMessage) {
     return CommandResult::SUCCESS_GAME_JOIN;
 }
 
+//////////////////////////      LOBBY ROOMS      //////////////////////////
+
+CommandResult RoomCommand::execute(const ProcessedMessage &processedMessage) {
+    if (globalState.isInGame(processedMessage.user)) {
+        return CommandResult::ERROR_INVALID_COMMAND;
+    }
+
+    if (!processedMessage.arguments.empty() &&
+        !globalState.joinRoom(processedMessage.user, processedMessage.arguments[0])) {
+        return CommandResult::ERROR_INVALID_ROOM_NAME;
+    }
+
+    std::stringstream notification;
+    notification << globalState.getRoomsAsString()
+                 << "You are in room " << globalState.getRoomName(processedMessage.user) << "\n\n";
+    outgoing.push_back({processedMessage.user, notification.str()});
+
+    return CommandResult::SUCCESS;
+}
+
+//////////////////////////      QUEUE FOR GAME      //////////////////////////
+
+CommandResult QueueGameCommand::execute(const ProcessedMessage &processedMessage) {
+    if (globalState.isInGame(processedMessage.user)) {
+        return CommandResult::ERROR_INVALID_COMMAND;
+    }
+    if (processedMessage.arguments.empty()) {
+        return CommandResult::ERROR_INCORRECT_COMMAND_FORMAT;
+    }
+
+    int gameIndex;
+    if (!parseNumber(processedMessage.arguments[0], gameIndex) || !globalState.isGameIndex(gameIndex)) {
+        return CommandResult::ERROR_INVALID_GAME_INDEX;
+    }
+
+    globalState.queueForGame(processedMessage.user, gameIndex);
+
+    std::stringstream notification;
+    notification << "Queued for " << globalState.getGameName(gameIndex) << ", "
+                 << globalState.getQueueLength(gameIndex) << " players waiting.\n"
+                 << "The game starts as soon as enough players are queued\n\n";
+    outgoing.push_back({processedMessage.user, notification.str()});
+
+    return CommandResult::SUCCESS;
+}
+
 /////////////////////       IN GAME COMMANDS - OWNER      /////////////////////
 
 //////////////////////////      START GAME      //////////////////////////
 
-CommandResult StartGameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult StartGameCommand::execute(const ProcessedMessage &processedMessage) {
     if (!globalState.isInGame(processedMessage.user)) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
@@ -140,10 +187,8 @@ CommandResult StartGameCommand::execute(ProcessedMessage &processedMessage) {
         return CommandResult::ERROR_NOT_ENOUGH_PLAYERS;
     }
 
-    std::deque<Message> messages = globalState.buildMsgsForOtherPlayers("\nGame Started!\n\n", processedMessage.user);
-    for (auto message : messages) {
-        outgoing.push_back(message);
-    }
+    globalState.buildMsgsForOtherPlayers("\nGame Started!\n\n", processedMessage.user, outgoing,
+        gameStateEvent(GameStateChange::Started, globalState.getGameID(processedMessage.user)));
 
     globalState.startGame(processedMessage.user);
 
@@ -152,7 +197,7 @@ CommandResult StartGameCommand::execute(ProcessedMessage &processedMessage) {
 
 //////////////////////////      END GAME      //////////////////////////
 
-CommandResult EndGameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult EndGameCommand::execute(const ProcessedMessage &processedMessage) {
     if (!globalState.isInGame(processedMessage.user)) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
@@ -160,10 +205,8 @@ CommandResult EndGameCommand::execute(ProcessedMessage &processedMessage) {
         return CommandResult::ERROR_NOT_AN_OWNER;
     }
 
-    std::deque<Message> messages = globalState.buildMsgsForOtherPlayers("\nGame Ended!\n\n", processedMessage.user);
-    for (auto message : messages) {
-        outgoing.push_back(message);
-    }
+    globalState.buildMsgsForOtherPlayers("\nGame Ended!\n\n", processedMessage.user, outgoing,
+        gameStateEvent(GameStateChange::Ended, globalState.getGameID(processedMessage.user)));
 
     globalState.endGame(processedMessage.user);
 
@@ -174,7 +217,7 @@ CommandResult EndGameCommand::execute(ProcessedMessage &processedMessage) {
 
 //////////////////////////      LEAVE GAME      //////////////////////////
 
-CommandResult LeaveGameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult LeaveGameCommand::execute(const ProcessedMessage &processedMessage) {
     if (!globalState.isInGame(processedMessage.user)) {
         return CommandResult::ERROR_INVALID_COMMAND;
     }
@@ -189,7 +232,7 @@ CommandResult LeaveGameCommand::execute(ProcessedMessage &processedMessage) {
 
 //////////////////////////      EXIT SERVER      //////////////////////////
 
-CommandResult ExitServerCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult ExitServerCommand::execute(const ProcessedMessage &processedMessage) {
     if (globalState.isOwner(processedMessage.user)) {
         return executeOwnerImpl(processedMessage);
     }
@@ -200,21 +243,20 @@ CommandResult ExitServerCommand::execute(ProcessedMessage &processedMessage) {
     return CommandResult::SUCCESS;
 }
 
-CommandResult ExitServerCommand::executePlayerImpl(ProcessedMessage &processedMessage) {
+CommandResult ExitServerCommand::executePlayerImpl(const ProcessedMessage &processedMessage) {
     handlePlayerLeave(globalState, outgoing, processedMessage.user);
     globalState.disconnectUser(processedMessage.user);
 
     return CommandResult::SUCCESS;
 }
 
-CommandResult ExitServerCommand::executeOwnerImpl(ProcessedMessage &processedMessage) {
-    std::deque<Message> messages = globalState.buildMsgsForOtherPlayers(
+CommandResult ExitServerCommand::executeOwnerImpl(const ProcessedMessage &processedMessage) {
+    globalState.buildMsgsForOtherPlayers(
         "\nOwner left the server. Game Ended!\n\n",
-        processedMessage.user
+        processedMessage.user,
+        outgoing,
+        gameStateEvent(GameStateChange::Ended, globalState.getGameID(processedMessage.user))
     );
-    for (auto message : messages) {
-        outgoing.push_back(message);
-    }
 
     globalState.endGame(processedMessage.user);
     globalState.disconnectUser(processedMessage.user);
@@ -224,7 +266,7 @@ CommandResult ExitServerCommand::executeOwnerImpl(ProcessedMessage &processedMes
 
 //////////////////////////      SET OR CHANGE USERNAME      //////////////////////////
 
-CommandResult UserNameCommand::execute(ProcessedMessage &processedMessage) {
+CommandResult UserNameCommand::execute(const ProcessedMessage &processedMessage) {
     if (processedMessage.arguments.empty()) {
         return CommandResult::ERROR_INCORRECT_COMMAND_FORMAT;
     }
@@ -236,7 +278,7 @@ CommandResult UserNameCommand::execute(ProcessedMessage &processedMessage) {
     if (!globalState.isInLobby(processedMessage.user)) {
         globalState.addClientToLobby(processedMessage.user);
     }
-    globalState.setName(processedMessage.user, processedMessage.arguments[0]);
+    globalState.setName(processedMessage.user, std::string(processedMessage.arguments[0]));
 
     std::stringstream notification;
     notification << "\n" << "Hello, "<<processedMessage.arguments[0] << "!\n";
@@ -1,11 +1,26 @@
 #include "messageProcessor.h"
 
+#include <algorithm>
+
 std::deque<ProcessedMessage>
 MessageProcessor::getProcessedMessages(const std::deque<Message> &incoming) {
     std::deque<ProcessedMessage> processedMessages;
 
-    for (auto message : incoming) {
-        processedMessages.push_back(createProcessedMessage(message));
+    for (const auto& message : incoming) {
+        if (message.protocol == Protocol::Binary) {
+            std::string_view frames = message.text;
+            Opcode opcode;
+            std::string_view fields;
+            while (nextFrame(frames, opcode, fields)) {
+                processedMessages.push_back(decodeFrame(message.user, opcode, fields));
+            }
+            // trailing bytes that do not form a whole frame
+            if (!frames.empty()) {
+                processedMessages.push_back(decodeFrame(message.user, {}, {}));
+            }
+        } else {
+            processedMessages.push_back(createProcessedMessage(message));
+        }
     }
 
     return processedMessages;
@@ -13,20 +28,27 @@ MessageProcessor::getProcessedMessages(const std::deque<Message> &incoming) {
 
 ProcessedMessage MessageProcessor::createProcessedMessage(const Message &message) {
 
+    if (message.protocol == Protocol::Binary) {
+        std::string_view frames = message.text;
+        Opcode opcode{};
+        std::string_view fields;
+        nextFrame(frames, opcode, fields);
+        return decodeFrame(message.user, opcode, fields);
+    }
+
     ProcessedMessage processedMessage;
-    std::vector<std::string> messageTokens = tokenizeMessage(message.text);
     processedMessage.user = message.user;
 
-    std::string commandString = messageTokens[0];
+    std::string_view text = message.text;
+    auto command = lookupCommand(nextToken(text));
 
-    if (CommandStringMap.find(commandString) != CommandStringMap.end()) {
+    if (command) {
         processedMessage.isCommand = true;
-        processedMessage.commandType = CommandStringMap[commandString];
+        processedMessage.commandType = *command;
 
-        auto eraseBegin = std::remove(messageTokens.begin(), messageTokens.end(), commandString);
-        messageTokens.erase(eraseBegin, messageTokens.end());
-
-        processedMessage.arguments = messageTokens;
+        for (auto token = nextToken(text); !token.empty(); token = nextToken(text)) {
+            processedMessage.arguments.push_back(token);
+        }
     } else {
         processedMessage.input = message.text;
     }
@@ -34,27 +56,57 @@ ProcessedMessage MessageProcessor::createProcessedMessage(const Message &message
     return processedMessage;
 }
 
-std::vector<std::string>
-MessageProcessor::tokenizeMessage(const std::string &text) {
+ProcessedMessage
+MessageProcessor::decodeFrame(User user, Opcode opcode, std::string_view fields) {
+    ProcessedMessage processedMessage;
+    processedMessage.user = user;
 
-    std::vector<std::string> tokens;
-    std::string token;
-    std::stringstream ss(text);
-    while (ss >> token) {
-        tokens.push_back(token);
+    FieldReader reader{fields};
+    switch (opcode) {
+        case Opcode::Command: {
+            uint8_t code;
+            if (!reader.u8(code) || std::size(COMMAND_CODES) <= code) {
+                break;
+            }
+            processedMessage.isCommand = true;
+            processedMessage.commandType = COMMAND_CODES[code];
+            for (std::string_view argument; reader.string(argument);) {
+                processedMessage.arguments.push_back(argument);
+            }
+            // a truncated argument makes the whole command malformed
+            processedMessage.malformed = !reader.empty();
+            return processedMessage;
+        }
+        case Opcode::Choice: {
+            uint32_t index;
+            if (reader.u32(index)) {
+                processedMessage.choice = index;
+                return processedMessage;
+            }
+            break;
+        }
+        case Opcode::Input:
+            processedMessage.input = reader.rest();
+            return processedMessage;
+        default:
+            break;
     }
-
-    return tokens;
+    processedMessage.malformed = true;
+    return processedMessage;
 }
 
-void MessageProcessor::initializeCommandStringMap() {
-    CommandStringMap["exit"] = UserCommand::EXIT;
-    CommandStringMap["help"] = UserCommand::HELP;
-    CommandStringMap["games"] = UserCommand::GAMES;
-    CommandStringMap["create"] = UserCommand::CREATE;
-    CommandStringMap["join"] = UserCommand::JOIN;
-    CommandStringMap["start"] = UserCommand::START;
-    CommandStringMap["leave"] = UserCommand::LEAVE;
-    CommandStringMap["end"] = UserCommand::END;
-    CommandStringMap["name"] = UserCommand::USERNAME;
+std::string_view
+MessageProcessor::nextToken(std::string_view &text) {
+    constexpr std::string_view whitespace = " \t\n\v\f\r";
+
+    size_t begin = text.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos) {
+        text = {};
+        return {};
+    }
+    size_t end = std::min(text.find_first_of(whitespace, begin), text.size());
+
+    std::string_view token = text.substr(begin, end - begin);
+    text.remove_prefix(end);
+    return token;
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Size of a cache line. Data written by different threads is aligned to it so that
+ * the threads do not invalidate each other's cache lines (false sharing).
+ */
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+constexpr size_t roundUpToPowerOfTwo(size_t value) {
+    size_t power = 1;
+    while (power < value) {
+        power <<= 1;
+    }
+    return power;
+}
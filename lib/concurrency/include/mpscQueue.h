@@ -0,0 +1,105 @@
+#pragma once
+
+#include "cacheLine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+
+/**
+ * A bounded lock-free queue between any number of producer threads and a single consumer thread.
+ *
+ * Every slot carries a sequence number telling whether it is free for the producer claiming
+ * that position or holds a value ready for the consumer. Producers claim positions with a
+ * single compare and swap on the tail, and each slot sits on its own cache line so producers
+ * writing neighbouring slots do not contend. Values are moved in and out of slots that are
+ * constructed up front, so push() and pop() never allocate. The capacity is rounded up to a
+ * power of two.
+ */
+template <typename T>
+class MPSCQueue {
+public:
+    explicit MPSCQueue(size_t capacity)
+        : size(roundUpToPowerOfTwo(capacity)), mask(size - 1), slots(new Slot[size]) {
+        for (size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    /**
+     * Any thread. Returns false, leaving value untouched, if the queue is full.
+     */
+    bool push(T&& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Consumer only. Returns false if the queue is empty.
+     */
+    bool pop(T& value) {
+        Slot& slot = slots[head & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.sequence.store(head + size, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+    /**
+     * Consumer only. Moves up to max values to the back of output, returns the number moved.
+     */
+    template <typename Container>
+    size_t popBatch(Container& output, size_t max = std::numeric_limits<size_t>::max()) {
+        size_t count = 0;
+        while (count < max) {
+            Slot& slot = slots[head & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            output.push_back(std::move(slot.value));
+            slot.sequence.store(head + size, std::memory_order_release);
+            head++;
+            count++;
+        }
+        return count;
+    }
+
+    size_t capacity() const { return size; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t size;
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0}; // next position claimed by a producer
+    alignas(CACHE_LINE_SIZE) size_t head = 0;              // next position read by the consumer
+};
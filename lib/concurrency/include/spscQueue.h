@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cacheLine.h"
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounded lock-free queue between exactly one producer thread and one consumer thread.
+ *
+ * All slots are constructed up front and values are moved in and out of them, so push()
+ * and pop() never allocate. The capacity is rounded up to a power of two.
+ * Each side keeps a cached copy of the other side's index and only reloads it when the
+ * queue looks full (or empty), so most operations touch a single shared cache line.
+ */
+template <typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity)
+        : slots(roundUpToPowerOfTwo(capacity)), mask(slots.size() - 1) {
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    /**
+     * Producer only. Returns false, leaving value untouched, if the queue is full.
+     */
+    bool push(T&& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cached_head == slots.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (position - cached_head == slots.size()) {
+                return false;
+            }
+        }
+        slots[position & mask] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Consumer only. Returns false if the queue is empty.
+     */
+    bool pop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (position == cached_tail) {
+                return false;
+            }
+        }
+        value = std::move(slots[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0}; // next slot to pop
+    size_t cached_tail = 0;
+
+    // producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0}; // next slot to push
+    size_t cached_head = 0;
+};
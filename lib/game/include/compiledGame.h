@@ -0,0 +1,84 @@
+#pragma once
+
+#include "game.h"
+#include "list.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * Runtime support for games that were compiled ahead of time by the gamecompiler tool.
+ *
+ * The compiler reads a game configuration through the InterpretJson front end and emits
+ * C++ source where the configuration lists are baked into constexpr tables and the rules
+ * are compiled to C++ (see compiledRules.h), so no JSON parsing or expression parsing
+ * happens when a game instance is created and no expression tree is resolved while it
+ * runs. The generated source is built into a shared object that exports GAME_PLUGIN_ENTRY.
+ */
+
+enum class BakedType {
+    Int,
+    Bool,
+    String,
+    Vector,
+    Map,
+};
+
+/**
+ * A single node of a list baked into a flat constexpr table.
+ * Children of a Vector or Map node are stored contiguously at [first_child, first_child + num_children)
+ */
+struct BakedElement {
+    BakedType type;
+    const char* key;    // key in the parent map, nullptr if the parent is not a map
+    int value;          // Int and Bool payload
+    const char* text;   // String payload
+    unsigned first_child;
+    unsigned num_children;
+};
+
+/**
+ * Rebuilds the list rooted at table[index] as ListElements
+ */
+ElementSptr unbake(const BakedElement* table, unsigned index = 0);
+
+/**
+ * The table of entry points exported by a compiled game.
+ *  - config_name : name of the json file the game was compiled from (eg. Rock_Paper_Scissors)
+ *  - build : fills in the configuration, game state and rules of a default constructed game
+ */
+struct GamePlugin {
+    const char* config_name;
+    void (*build)(Game& game);
+};
+
+using GamePluginEntry = const GamePlugin* (*)();
+constexpr const char* GAME_PLUGIN_ENTRY = "socialGamingPlugin";
+
+/**
+ * A compiled game loaded from a shared object. Used in place of the InterpretJson
+ * front end when creating instances of that game.
+ *
+ * NOTE: the shared object stays loaded for the lifetime of the process since game
+ * instances hold objects whose code lives in it.
+ */
+class CompiledGame {
+public:
+    /**
+     * Loads the compiled game at path. Returns nullptr if the library could not be
+     * opened or does not export GAME_PLUGIN_ENTRY.
+     */
+    static std::unique_ptr<CompiledGame> load(const std::string& path);
+
+    explicit CompiledGame(const GamePlugin& plugin) : plugin(plugin) {}
+
+    /**
+     * Creates a new game instance owned by owner, the same way InterpretJson::interpret() does
+     */
+    Game instantiate(User owner) const;
+
+    std::string configName() const { return plugin.config_name; }
+
+private:
+    const GamePlugin& plugin;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "rules.h"
+#include "list.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * Runtime support for the rules of compiled games (see compiledGame.h).
+ *
+ * The gamecompiler emits each rule of a game as a struct whose execute() runs the rule
+ * as plain C++: expressions become direct calls on the elements they resolve to, and
+ * control structures hold their child rules as members and call them without virtual
+ * dispatch. The structs keep the semantics of the interpreted rules in rules.h, including
+ * how they spend the ExecutionBudget and resume after yielding or requiring input.
+ * Game runs each top level struct through a CompiledRule.
+ */
+
+/**
+ * The parts of a game the compiled rules act on. lists holds the lists the expressions
+ * of the game refer to, bound when the game is built, like ExpressionTree::build() binds them.
+ */
+struct CompiledContext {
+    std::shared_ptr<PlayerMap> players;
+    std::shared_ptr<std::deque<std::string>> global_msgs;
+    std::shared_ptr<std::deque<InputRequest>> input_requests;
+    std::shared_ptr<std::map<User, InputResponse>> player_input;
+    ElementVector lists;
+};
+
+/**
+ * A top level rule of a compiled game, Body is the struct emitted for it
+ */
+template <typename Body>
+class CompiledRule final : public Rule {
+public:
+    explicit CompiledRule(CompiledContext context) : context(std::move(context)) {}
+
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) override {
+        return body.execute(context, game_state, budget);
+    }
+
+private:
+    CompiledContext context;
+    Body body;
+};
+
+/**
+ * executeWithBudget() for a child rule of a compiled control structure
+ */
+template <typename Body>
+RuleStatus executeWithBudget(Body& rule, CompiledContext& context, ElementMap& game_state,
+                             ExecutionBudget& budget, bool& resuming) {
+    if (!resuming && !budget.spend()) {
+        return RuleStatus::Yielded;
+    }
+    RuleStatus status = rule.execute(context, game_state, budget);
+    resuming = status == RuleStatus::Yielded;
+    return status;
+}
+
+// Expressions, resolved as by ExpressionResolver //
+
+// an element passed down from a parent rule (eg. player, weapon), otherwise the name as a string
+inline ElementSptr resolveName(ElementMap& game_state, const char* name) {
+    auto element = game_state.find(name);
+    if (element != game_state.end()) {
+        return element->second;
+    }
+    return std::make_shared<Element<std::string>>(std::string(name));
+}
+
+inline ElementSptr allPlayers(const PlayerMap& players) {
+    ElementVector all;
+    for (auto& [player_connection, player] : players) {
+        all.emplace_back(player);
+    }
+    return std::make_shared<Element<ElementVector>>(all);
+}
+
+// the '.' operator, key of a map or the sublist of key of a list
+inline ElementSptr member(const ElementSptr& element, const char* key) {
+    if (element->type == Type::VECTOR) {
+        return std::make_shared<Element<ElementVector>>(element->getSubList(key));
+    }
+    return element->getMapElement(key);
+}
+
+// the comparison operators compare elements of the same type by their string
+inline int compare(const ElementSptr& left, const ElementSptr& right) {
+    assert(left->type == right->type && "Invalid node during evaluation");
+    return left->getString().compare(right->getString());
+}
@@ -12,12 +12,24 @@
 
 enum GameStatus {
     Created,
-    Running,
+    Running,        // the execution budget ran out before input was required, resume with run()
     Finished,
     AwaitingInput,
     AwaitingOutput
 };
 
+/**
+ * The per-player integers of a game (e.g. wins), one row per player
+ */
+struct ScoreTable {
+    struct Row {
+        std::string player;
+        std::vector<int> scores;
+    };
+    std::vector<std::string> columns;
+    std::vector<Row> rows;
+};
+
 class Game {
 public:
     Game();
@@ -25,6 +37,11 @@ public:
         std::string name, User owner
     );
 
+    /**
+     * Executes rules until input is required, the game ends or the budget runs out.
+     * Each call continues where the previous one stopped.
+     */
+    void run(ExecutionBudget& budget);
     void run();
     GameStatus status();
 
@@ -47,7 +64,8 @@ public:
     bool hasEnoughPlayers();
 
     std::deque<std::string> globalMsgs();
-    std::deque<InputRequest> inputRequests();
+    const std::deque<InputRequest>& inputRequests();
+    ScoreTable scores();
 
     void outputSent();
     void registerPlayerInput(User player, std::string input);
@@ -84,6 +102,8 @@ public:
     ElementSptr _per_player; // a map template for players
     ElementSptr _per_audience; // a map template for audience members
     RuleVector _rules;
+    size_t _next_rule = 0; // the top level rule execution continues from
+    bool _resuming_rule = false; // whether _next_rule yielded (see executeWithBudget)
 
     std::shared_ptr<PlayerMap> _players = std::make_shared<PlayerMap>(PlayerMap{}); // maps each player to their game map
     std::shared_ptr<PlayerMap> _audience = std::make_shared<PlayerMap>(PlayerMap{}); // maps each audience to their game map
@@ -3,7 +3,9 @@
 #include "list.h"
 
 #include <vector>
+#include <chrono>
 #include <functional>
+#include <limits>
 #include "ASTVisitor.h"
 #include "ExpressionResolver.h"
 
@@ -14,6 +16,45 @@ using RuleVector = std::vector<RuleSptr>;
 enum RuleStatus {
     Done,
     InputRequired,
+    Yielded,    // the execution budget ran out, execution resumes here on the next run
+};
+
+/**
+ * Bounds how much rule execution a single Game::run() may perform.
+ *
+ * Every rule started by the game or by a control structure (foreach, parallelfor, when)
+ * spends one step, and each case condition of a when spends one step. Once the steps
+ * are used up or the deadline has passed, the control structure yields with all of its
+ * iterators intact so that the next run continues exactly where this one stopped.
+ * Resuming a rule that yielded does not spend a step, so every run makes progress.
+ */
+class ExecutionBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static ExecutionBudget unlimited() {
+        return ExecutionBudget(std::numeric_limits<unsigned>::max(), Clock::time_point::max());
+    }
+
+    ExecutionBudget(unsigned steps, Clock::time_point deadline)
+        : steps(steps), deadline(deadline) {
+    }
+
+    // Returns true if another step may be executed
+    bool spend() {
+        if (steps == 0 || (deadline != Clock::time_point::max() && Clock::now() >= deadline)) {
+            steps = 0;
+            return false;
+        }
+        steps--;
+        return true;
+    }
+
+    bool exhausted() const { return steps == 0; }
+
+private:
+    unsigned steps;
+    Clock::time_point deadline;
 };
 
 enum InputType {
@@ -34,6 +75,10 @@ struct InputRequest {
     unsigned num_choices; // doesn't apply for InputType::Text
     bool has_timeout = false;
     unsigned timeout_ms = 0;
+
+    // the prompt in parts, for clients that render it themselves (see Opcode::Prompt)
+    std::string question;
+    std::vector<std::string> choices;
 };
 
 struct InputResponse {
@@ -43,18 +88,55 @@ struct InputResponse {
 
 // Rule Interface //
 
+class Rule;
+
+/**
+ * Starts rule, spending a step of the budget, or resumes it without spending if it yielded
+ * on the previous call. resuming tracks the latter for the caller and should start false.
+ */
+RuleStatus executeWithBudget(Rule& rule, ElementMap& game_state, ExecutionBudget& budget, bool& resuming);
+
 class Rule {
 public:
     virtual ~Rule() {}
-    virtual RuleStatus execute(ElementMap& game_state) = 0;
-    
+    virtual RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) = 0;
+};
+
+/**
+ * A rule of an interpreted game, its expressions are trees resolved on every execution.
+ * Compiled games implement Rule directly (see compiledRules.h).
+ */
+class InterpretedRule : public Rule {
 protected:
     ExpressionResolver resolver;
 };
 
+// Shared by the interpreted and compiled rules //
+
+/**
+ * Replaces the first {} placeholder of msg with element, a list is joined with ", ".
+ * element may be null if msg has no placeholder.
+ */
+std::string formatString(std::string msg, const ElementSptr& element);
+
+/**
+ * The request of an input-choice rule asking user to choose one of choices
+ */
+InputRequest makeChoiceRequest(User user, std::string question, const ElementVector& choices, unsigned timeout_s);
+
+/**
+ * The index chosen by an answer to a choice request, 0 if the request timed out
+ */
+int chosenIndex(const InputResponse& input);
+
+/**
+ * The message of a scores rule, listing attribute_key of every player
+ */
+std::string scoresMessage(const PlayerMap& player_maps, const std::string& attribute_key, bool ascending);
+
 // Control Structures//
 
-class Foreach : public Rule {
+class Foreach : public InterpretedRule {
 private:
     std::shared_ptr<ASTNode> list_expression_root;
     std::string element_name;
@@ -66,26 +148,29 @@ private:
     ElementVector::iterator element;
     RuleVector::iterator rule;
     bool initialized = false;
+    bool resuming = false;
 
 public:
     Foreach(std::shared_ptr<ASTNode> list_expression_root, std::string element_name, RuleVector rules);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
-class ParallelFor : public Rule {
+class ParallelFor : public InterpretedRule {
     std::shared_ptr<PlayerMap> player_maps;
     RuleVector rules;
     std::string element_name;
 
     std::map<User, RuleVector::iterator> player_rule_it;
+    std::map<User, bool> player_awaiting_input; // players that reached an input rule during the current pass
     bool initialized = false;
+    bool resuming = false;
 
 public:
     ParallelFor(std::shared_ptr<PlayerMap> player_maps, RuleVector rules, std::string element_name);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
-class When : public Rule {
+class When : public InterpretedRule {
     using Condition_Rules = std::vector<std::pair<std::shared_ptr<ASTNode>, RuleVector>>;
     // a vector of case-rules pairs
     // containes a rule list for every case
@@ -93,42 +178,44 @@ class When : public Rule {
     Condition_Rules conditionExpression_rule_pairs;
     Condition_Rules::iterator conditionExpression_rule_pair;
     RuleVector::iterator rule;
+    bool matched = false; // a case matched and its rules are being executed
+    bool resuming = false;
 public: 
     When(Condition_Rules conditonExpression_rule_pairs);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
 // List Operations //
 
-class Extend : public Rule {
+class Extend : public InterpretedRule {
     std::shared_ptr<ASTNode> target_expression_root;
     std::shared_ptr<ASTNode> extension_expression_root;
 public:
     Extend(std::shared_ptr<ASTNode> target_expression_root, std::shared_ptr<ASTNode> extension_expression_root);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
-class Discard : public Rule {
+class Discard : public InterpretedRule {
     std::shared_ptr<ASTNode> list_expression_root;
     std::shared_ptr<ASTNode> count_expression_root;
 public:
     Discard(std::shared_ptr<ASTNode> list_expression_root,  std::shared_ptr<ASTNode> count_expression_root);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
 // Arithmetic //
 
-class Add : public Rule {
+class Add : public InterpretedRule {
     std::shared_ptr<ASTNode> element_expression_root;
     std::shared_ptr<ASTNode> value_expression_root;
 public: 
     Add(std::shared_ptr<ASTNode> element_expression_root,  std::shared_ptr<ASTNode> value_expression_root);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
 // Input/ Output //
 
-class InputChoice : public Rule {
+class InputChoice : public InterpretedRule {
     std::string prompt;
     std::shared_ptr<ASTNode> element_to_replace_root;
 
@@ -149,10 +236,10 @@ public:
                 std::shared_ptr<std::deque<InputRequest>> input_requests,
                 std::shared_ptr<std::map<User, InputResponse>> player_input,
                 std::string result, unsigned timeout_s = 0);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
-class GlobalMsg : public Rule {
+class GlobalMsg : public InterpretedRule {
     std::string msg;
     std::shared_ptr<ASTNode> element_to_replace_root;
     std::shared_ptr<std::deque<std::string>> global_msgs;
@@ -160,10 +247,10 @@ class GlobalMsg : public Rule {
 public:
     GlobalMsg(std::string msg, std::shared_ptr<ASTNode> element_to_replace_root,
               std::shared_ptr<std::deque<std::string>> global_msgs);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
 
-class Scores : public Rule {
+class Scores : public InterpretedRule {
     std::shared_ptr<PlayerMap> player_maps;
     std::string attribute_key;
     bool ascending;
@@ -171,5 +258,5 @@ class Scores : public Rule {
 public:
     Scores(std::shared_ptr<PlayerMap> player_maps, std::string attribute_key, 
            bool ascending, std::shared_ptr<std::deque<std::string>> global_msgs);
-    RuleStatus execute(ElementMap& game_state) final;
+    RuleStatus execute(ElementMap& game_state, ExecutionBudget& budget) final;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "compiledGame.h"
+
+#include <dlfcn.h>
+#include <glog/logging.h>
+
+ElementSptr unbake(const BakedElement* table, unsigned index) {
+    const BakedElement& baked = table[index];
+    switch (baked.type) {
+        case BakedType::Int:
+            return std::make_shared<Element<int>>(baked.value);
+        case BakedType::Bool:
+            return std::make_shared<Element<bool>>(baked.value != 0);
+        case BakedType::String:
+            return std::make_shared<Element<std::string>>(std::string(baked.text));
+        case BakedType::Vector: {
+            ElementVector vector;
+            vector.reserve(baked.num_children);
+            for (unsigned i = 0; i < baked.num_children; i++) {
+                vector.push_back(unbake(table, baked.first_child + i));
+            }
+            return std::make_shared<Element<ElementVector>>(vector);
+        }
+        case BakedType::Map: {
+            ElementMap map;
+            for (unsigned i = 0; i < baked.num_children; i++) {
+                const char* key = table[baked.first_child + i].key;
+                map[key ? key : ""] = unbake(table, baked.first_child + i);
+            }
+            return std::make_shared<Element<ElementMap>>(map);
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<CompiledGame> CompiledGame::load(const std::string& path) {
+    void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) {
+        LOG(ERROR) << "Unable to load compiled game " << path << ": " << dlerror();
+        return nullptr;
+    }
+
+    auto entry = reinterpret_cast<GamePluginEntry>(dlsym(library, GAME_PLUGIN_ENTRY));
+    if (entry == nullptr) {
+        LOG(ERROR) << path << " is not a compiled game: " << dlerror();
+        dlclose(library);
+        return nullptr;
+    }
+
+    // the library is intentionally never closed, see CompiledGame
+    return std::make_unique<CompiledGame>(*entry());
+}
+
+Game CompiledGame::instantiate(User owner) const {
+    Game game;
+    plugin.build(game);
+    game.setID();
+    game.setOwner(owner);
+    game.setName(plugin.config_name);
+    return game;
+}
@@ -37,12 +37,16 @@ Game::Game(std::string name, User owner)
 //     _id = shared_id_counter++;
 // }
 
-// starts the game execution
-void Game::run() {
+// starts or continues the game execution
+void Game::run(ExecutionBudget& budget) {
     _status = GameStatus::Running;
 
-    for (auto rule: _rules) {
-        if (rule->execute(_game_state) == RuleStatus::InputRequired) {
+    for (; _next_rule < _rules.size(); _next_rule++) {
+        RuleStatus rule_status = executeWithBudget(*_rules[_next_rule], _game_state, budget, _resuming_rule);
+        if (rule_status == RuleStatus::Yielded) {
+            return;
+        }
+        if (rule_status == RuleStatus::InputRequired) {
             _status = GameStatus::AwaitingOutput;
             return;
         }
@@ -50,6 +54,11 @@ void Game::run() {
     _status = GameStatus::Finished;
 }
 
+void Game::run() {
+    ExecutionBudget budget = ExecutionBudget::unlimited();
+    run(budget);
+}
+
 GameStatus Game::status() {
     return _status;
 }
@@ -115,12 +124,12 @@ uintptr_t Game::id() {
 }
 
 std::deque<std::string> Game::globalMsgs() {
-    std::deque<std::string> tmp = *_global_msgs;
-    _global_msgs->clear();
+    std::deque<std::string> tmp;
+    tmp.swap(*_global_msgs);
     return tmp;
 }
 
-std::deque<InputRequest> Game::inputRequests() {
+const std::deque<InputRequest>& Game::inputRequests() {
     return *_input_requests;
 }
 
@@ -155,6 +164,27 @@ ElementSptr Game::constants(){
 ElementSptr Game::variables(){
     return _game_state["variables"];
 }
+ScoreTable Game::scores() {
+    ScoreTable table;
+    if (_per_player == nullptr) {
+        return table;
+    }
+    for (auto& [name, element] : _per_player->getMap()) {
+        if (element->type == Type::INT) {
+            table.columns.push_back(name);
+        }
+    }
+    for (auto& [user, player] : *_players) {
+        ScoreTable::Row row{player->getMapElement("name")->getString(), {}};
+        for (auto& column : table.columns) {
+            auto score = player->getMapElement(column);
+            row.scores.push_back(score ? score->getInt() : 0);
+        }
+        table.rows.push_back(std::move(row));
+    }
+    return table;
+}
+
 ElementSptr Game::per_player(){
     return _per_player;
 }
@@ -163,4 +193,4 @@ ElementSptr Game::per_audience(){
 }
 RuleVector& Game::rules(){
     return _rules;
-}
\ No newline at end of file
+}
@@ -5,13 +5,22 @@
 #include <sstream>
 #include <glog/logging.h>
 
+RuleStatus executeWithBudget(Rule& rule, ElementMap& game_state, ExecutionBudget& budget, bool& resuming) {
+    if (!resuming && !budget.spend()) {
+        return RuleStatus::Yielded;
+    }
+    RuleStatus status = rule.execute(game_state, budget);
+    resuming = status == RuleStatus::Yielded;
+    return status;
+}
+
 // Foreach //
 
 Foreach::Foreach(std::shared_ptr<ASTNode> list_expression_root, std::string element_name, RuleVector rules) 
     : list_expression_root(list_expression_root), element_name(element_name), rules(rules) {
 }
 
-RuleStatus Foreach::execute(ElementMap& game_state) {
+RuleStatus Foreach::execute(ElementMap& game_state, ExecutionBudget& budget) {
     LOG(INFO) << "* Foreach Rule *";
 
     // initialize the elements vector from the dynamic list object
@@ -25,14 +34,15 @@ RuleStatus Foreach::execute(ElementMap& game_state) {
         initialized = true;
     }
 
-    // execute the child rules for each element until input is required
+    // execute the child rules for each element until input is required or the budget runs out
     for (; element != elements.end(); element++) {
         // add element to game_state so that subrules can find it (eg. round, weapon, etc)
         game_state[element_name] = *element;
 
         for (; rule != rules.end(); rule++) {
-            if ((*rule)->execute(game_state) == RuleStatus::InputRequired) {
-                return RuleStatus::InputRequired;
+            RuleStatus status = executeWithBudget(**rule, game_state, budget, resuming);
+            if (status != RuleStatus::Done) {
+                return status;
             }
         }
         rule = rules.begin();
@@ -49,7 +59,7 @@ ParallelFor::ParallelFor(std::shared_ptr<PlayerMap> player_maps, RuleVector rule
     : player_maps(player_maps), rules(rules), element_name(element_name) {
 }
 
-RuleStatus ParallelFor::execute(ElementMap& game_state) {
+RuleStatus ParallelFor::execute(ElementMap& game_state, ExecutionBudget& budget) {
     LOG(INFO) << "* ParallelFor Rule *";
 
     // initialize the player rule iterators to the first rule
@@ -60,21 +70,31 @@ RuleStatus ParallelFor::execute(ElementMap& game_state) {
         initialized = true;
     }
 
-    RuleStatus status = RuleStatus::Done;
     // for each player, start rule execution at their stored rule iterator
     //  and execute the rules until an Input rule is encountered
+    // players that already reached an Input rule in this pass are skipped when resuming after a yield
     for(auto& [player_connection, player]: *player_maps) {
+        if (player_awaiting_input[player_connection]) continue;
+
         // set map element "player" to current player list so that subrules can find it
         game_state[element_name] = player;
 
         for (auto& rule = player_rule_it[player_connection]; rule != rules.end(); rule++) {
-            if ((*rule)->execute(game_state) == RuleStatus::InputRequired) {
-                status = RuleStatus::InputRequired;
+            RuleStatus status = executeWithBudget(**rule, game_state, budget, resuming);
+            if (status == RuleStatus::Yielded) {
+                return status;
+            }
+            if (status == RuleStatus::InputRequired) {
+                player_awaiting_input[player_connection] = true;
                 break;
             }
         }
     }
 
+    RuleStatus status = std::any_of(player_awaiting_input.begin(), player_awaiting_input.end(),
+        [](auto& awaiting) { return awaiting.second; }) ? RuleStatus::InputRequired : RuleStatus::Done;
+    player_awaiting_input.clear();
+
     // if rule execution is done this resets the rule iterators when rule is executed again in a different context 
     // otherwise the rule will continue where it left off after input is retrieved
     if (status == RuleStatus::Done) initialized = false;
@@ -89,32 +109,41 @@ When::When(Condition_Rules _conditionExpression_rule_pairs)
     rule(conditionExpression_rule_pair->second.begin()) {
 }
 
-RuleStatus When::execute(ElementMap& game_state) {
+RuleStatus When::execute(ElementMap& game_state, ExecutionBudget& budget) {
     LOG(INFO) << "* When Rule *";
 
-    // traverse the cases and execute the rules for the first case condition that returns true
+    // traverse the cases and find the first case condition that returns true
     // a conditionExpression_rule_pairs consists of a case condition (an expression tree root) and a rule vector
-    for (; conditionExpression_rule_pair != conditionExpression_rule_pairs.end(); conditionExpression_rule_pair++) {
+    // if a case already matched, this is a resumed execution and continues with its rules
+    for (; !matched && conditionExpression_rule_pair != conditionExpression_rule_pairs.end(); conditionExpression_rule_pair++) {
+        if (!budget.spend()) {
+            return RuleStatus::Yielded;
+        }
         auto& [condition_root, rules] = *conditionExpression_rule_pair;
-        rule = rules.begin();
 
         condition_root->accept(resolver, game_state);
         bool caseMatch = resolver.getResult()->getBool();    
         if (caseMatch) {
             LOG(INFO) << "Case Match!" << std::endl << "Executing Case Rules";
-
-            for (; rule != rules.end(); rule++) {
-                if ((*rule)->execute(game_state) == RuleStatus::InputRequired) {
-                    return RuleStatus::InputRequired;
-                }
-            }
+            rule = rules.begin();
+            matched = true;
             break;
         } else {
             LOG(INFO) << "Case Fail, testing next case";
         }
     }
 
+    if (matched) {
+        for (auto& rules = conditionExpression_rule_pair->second; rule != rules.end(); rule++) {
+            RuleStatus status = executeWithBudget(**rule, game_state, budget, resuming);
+            if (status != RuleStatus::Done) {
+                return status;
+            }
+        }
+    }
+
     // reset the rule state to be executed in a different context 
+    matched = false;
     conditionExpression_rule_pair = conditionExpression_rule_pairs.begin();
     rule = conditionExpression_rule_pair->second.begin();
     return RuleStatus::Done;
@@ -126,7 +155,7 @@ Extend::Extend(std::shared_ptr<ASTNode> target_expression_root, std::shared_ptr<
     : target_expression_root(target_expression_root), extension_expression_root(extension_expression_root) {
 }
 
-RuleStatus Extend::execute(ElementMap& game_state) {
+RuleStatus Extend::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* Extend Rule *";
     target_expression_root->accept(resolver, game_state);
     auto target = resolver.getResult();
@@ -144,7 +173,7 @@ Discard::Discard(std::shared_ptr<ASTNode> list_expression_root,  std::shared_ptr
     : list_expression_root(list_expression_root), count_expression_root(count_expression_root) {
 }
 
-RuleStatus Discard::execute(ElementMap& game_state) {
+RuleStatus Discard::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* Discard Rule *";
     list_expression_root->accept(resolver, game_state);
     auto list = resolver.getResult();
@@ -162,7 +191,7 @@ Add::Add(std::shared_ptr<ASTNode> element_expression_root,  std::shared_ptr<ASTN
     : element_expression_root(element_expression_root), value_expression_root(value_expression_root) {
 }
 
-RuleStatus Add::execute(ElementMap& game_state) {
+RuleStatus Add::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* Add Rule *";
     element_expression_root->accept(resolver, game_state);
     auto element = resolver.getResult();
@@ -176,16 +205,15 @@ RuleStatus Add::execute(ElementMap& game_state) {
 
 // InputChoice //
 
-//replaces string in {} with element
-std::string formatString(std::string msg, ExpressionResolver& resolver) {
+std::string formatString(std::string msg, const ElementSptr& element) {
     size_t open_brace = 0; 
     
     if ((open_brace = msg.find("{", open_brace)) != std::string::npos) {
         size_t close_brace = msg.find("}", open_brace);
         std::string resolvedString;
 
-        if(resolver.getResult()->type == VECTOR){
-            ElementVector resolvedStringVector = resolver.getResult()->getVector();
+        if(element->type == VECTOR){
+            ElementVector resolvedStringVector = element->getVector();
             for(auto it = resolvedStringVector.begin(); it != resolvedStringVector.end(); it++){
                 if(it != resolvedStringVector.begin())
                     resolvedString += ", ";
@@ -193,13 +221,60 @@ std::string formatString(std::string msg, ExpressionResolver& resolver) {
             }
         }
         else
-            resolvedString = resolver.getResult()->getString();
+            resolvedString = element->getString();
 
         msg.replace(open_brace, close_brace - open_brace + 1, resolvedString);
     }
     return msg + "\n";
 }
 
+InputRequest makeChoiceRequest(User user, std::string question, const ElementVector& choices, unsigned timeout_s) {
+    std::vector<std::string> choice_names;
+    std::stringstream formatted_prompt = std::stringstream(question);
+    formatted_prompt << formatted_prompt.str() << "Enter an index to select:\n";
+    for (size_t i = 0; i < choices.size(); i++) {
+        choice_names.push_back(choices[i]->getString());
+        formatted_prompt << "["<<i<<"] " << choice_names.back() << "\n";
+    }
+    if (timeout_s) formatted_prompt << "Input will timeout in " << timeout_s << " seconds\n"; 
+
+    InputRequest request(
+        user,
+        formatted_prompt.str(),
+        InputType::Choice,
+        choices.size(),
+        timeout_s,
+        timeout_s*1000
+    );
+    request.question = std::move(question);
+    request.choices = std::move(choice_names);
+    return request;
+}
+
+int chosenIndex(const InputResponse& input) {
+    // for now, if an input request times out, a default index of 0 is chosen
+    return input.timedout ? 0 : std::stoi(input.response);
+}
+
+std::string scoresMessage(const PlayerMap& player_maps, const std::string& attribute_key, bool ascending) {
+    std::stringstream msg;
+    msg << "\nScores are " << (ascending? "(in ascending order)\n" : "(in descending order)\n");
+
+    std::vector<std::pair<std::string, int>> scores;
+    for (auto& [player_connection, player_list]: player_maps) {
+        scores.emplace_back(
+            player_list->getMapElement("name")->getString(),
+            player_list->getMapElement(attribute_key)->getInt()
+        );
+    }
+    
+    std::sort(scores.begin(), scores.end(), [=](auto a, auto b){ return (a.second<b.second && ascending); });
+    for (auto& [player_name, score]: scores) {
+        msg << "player " << player_name << ": " << score << "\n";
+    }
+    return msg.str();
+}
+
 InputChoice::InputChoice(std::string prompt, 
                         std::shared_ptr<ASTNode> element_to_replace_root,
                         std::shared_ptr<ASTNode> choices_expression_root,
@@ -212,7 +287,7 @@ InputChoice::InputChoice(std::string prompt,
     result(result), timeout_s(timeout_s) {
 }
 
-RuleStatus InputChoice::execute(ElementMap& game_state) {
+RuleStatus InputChoice::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* InputChoiceRequest Rule *";
     User player_connection = game_state["player"]->getMapElement("user")->getConnection();
 
@@ -224,38 +299,17 @@ RuleStatus InputChoice::execute(ElementMap& game_state) {
         choices_expression_root->accept(resolver, game_state);
         choices = resolver.getResult()->getVector();
 
-        // format the input prompt
+        // format the input prompt and create an input request, flagging that input is required
         element_to_replace_root->accept(resolver, game_state);
-
-        std::stringstream formatted_prompt = std::stringstream(formatString(prompt, resolver));
-        formatted_prompt << formatted_prompt.str() << "Enter an index to select:\n";
-        for (size_t i = 0; i < choices.size(); i++) {
-            formatted_prompt << "["<<i<<"] " << choices[i]->getString() << "\n";
-        }
-        if (timeout_s) formatted_prompt << "Input will timeout in " << timeout_s << " seconds\n"; 
-
-        // create an input request and flag that input is required
-        input_requests->emplace_back(
-            player_connection,
-            formatted_prompt.str(),
-            InputType::Choice,
-            choices.size(),
-            timeout_s,
-            timeout_s*1000
-        );
+        input_requests->push_back(makeChoiceRequest(
+            player_connection, formatString(prompt, resolver.getResult()), choices, timeout_s
+        ));
         awaiting_input[player_connection] = true;
         return RuleStatus::InputRequired;
     }
     // execution will continue from here after input is recieved
 
-    int chosen_index;
-    InputResponse input = player_input->at(player_connection);
-    if (input.timedout) {
-        // for now, if an input request times out, a default index of 0 is chosen
-        chosen_index = 0;
-    } else {
-        chosen_index = std::stoi(input.response);
-    }
+    int chosen_index = chosenIndex(player_input->at(player_connection));
     game_state["player"]->setMapElement(result, choices[chosen_index]);
 
     awaiting_input[player_connection] = false;
@@ -270,12 +324,12 @@ GlobalMsg::GlobalMsg(std::string msg, std::shared_ptr<ASTNode> element_to_replac
     : msg(msg), element_to_replace_root(element_to_replace_root), global_msgs(global_msgs) {
 }
 
-RuleStatus GlobalMsg::execute(ElementMap& game_state) {
+RuleStatus GlobalMsg::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* GlobalMsg Rule *";
 
     element_to_replace_root->accept(resolver, game_state);
     
-    global_msgs->push_back(formatString(msg, resolver));
+    global_msgs->push_back(formatString(msg, resolver.getResult()));
     return RuleStatus::Done;
 }
 
@@ -287,24 +341,8 @@ Scores::Scores(std::shared_ptr<PlayerMap> player_maps, std::string attribute_key
       ascending(ascending), global_msgs(global_msgs) {
 }
 
-RuleStatus Scores::execute(ElementMap& game_state) {
+RuleStatus Scores::execute(ElementMap& game_state, ExecutionBudget& /*budget*/) {
     LOG(INFO) << "* Scores Rule *";
-    std::stringstream msg;
-    msg << "\nScores are " << (ascending? "(in ascending order)\n" : "(in descending order)\n");
-
-    std::vector<std::pair<std::string, int>> scores;
-    for (auto& [player_connection, player_list]: *player_maps) {
-        scores.emplace_back(
-            player_list->getMapElement("name")->getString(),
-            player_list->getMapElement(attribute_key)->getInt()
-        );
-    }
-    
-    std::sort(scores.begin(), scores.end(), [=](auto a, auto b){ return (a.second<b.second && ascending); });
-    for (auto& [player_name, score]: scores) {
-        msg << "player " << player_name << ": " << score << "\n";
-    }
-
-    global_msgs->push_back(msg.str());
+    global_msgs->push_back(scoresMessage(*player_maps, attribute_key, ascending));
     return RuleStatus::Done;
 }
\ No newline at end of file
@@ -13,7 +13,13 @@ using Json = nlohmann::json;
 class InterpretJson{
     public:
         InterpretJson(string game_name, User owner);
-        InterpretJson(std::string path);
+
+        /**
+         * Reads the configuration at path instead of the one of the game in gameconfigs,
+         * the game is named after the file (eg. path/to/Rock_Paper_Scissors.json)
+         */
+        static InterpretJson fromFile(const std::string& path);
+
         Game interpret();
     
         Json data;
@@ -21,6 +27,9 @@ class InterpretJson{
         User owner;
         ExpressionTree expressionTree;
         void toRuleVec(Game& game, const ElementSptr& rules_from_json, RuleVector& rule_vec);
+
+    private:
+        InterpretJson(std::string game_name, User owner, const std::string& path);
 };
 
 //recursively maps Json data to list element
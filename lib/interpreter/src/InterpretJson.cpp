@@ -1,3 +1,4 @@
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include "InterpretJson.h"
@@ -6,9 +7,17 @@
 using Json = nlohmann::json;
 
 InterpretJson::InterpretJson(std::string game_name, User owner) 
+    : InterpretJson(game_name, owner, PATH_TO_JSON + game_name + ".json") {
+}
+
+InterpretJson InterpretJson::fromFile(const std::string& path) {
+    return InterpretJson(std::filesystem::path(path).stem().string(), User{0}, path);
+}
+
+InterpretJson::InterpretJson(std::string game_name, User owner, const std::string& path)
     : game_name(game_name), owner(owner) {
     try {
-        ifstream f(PATH_TO_JSON + game_name + ".json");
+        ifstream f(path);
         Json jData = Json::parse(f);
         f.close();
         data = jData;
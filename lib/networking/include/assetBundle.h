@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ *  The files the Server sends in response to HTTP GET requests, e.g. the page
+ *  of the web client with its scripts and style sheets. A bundle is built once,
+ *  before the Server starts. Every asset is kept in memory together with its
+ *  gzip and brotli encodings and an ETag per encoding, so requests are answered
+ *  without touching the disk, compressing, or copying the content.
+ *
+ *  A bundle built from a single string serves it as `/index.html`.
+ */
+class AssetBundle {
+public:
+    enum class Encoding : uint8_t {
+        Identity,
+        Gzip,
+        Brotli
+    };
+    static constexpr size_t NUM_ENCODINGS = 3;
+
+    /**
+     *  The content of an asset in one encoding. Encodings that would not be
+     *  smaller than the content itself are left out and have an empty etag.
+     */
+    struct Variant {
+        std::string body;
+        std::string etag;
+    };
+
+    struct Asset {
+        std::string contentType;
+        std::string cacheControl;
+        std::array<Variant, NUM_ENCODINGS> variants;
+
+        /**
+         *  The smallest encoding allowed by the Accept-Encoding header of a request.
+         */
+        Encoding selectEncoding(std::string_view acceptEncoding) const;
+
+        /**
+         *  True if the If-None-Match header of a request names the variant in
+         *  encoding, the one selected for the request, so the client already has
+         *  it. The ETag of another encoding does not match, a client holding the
+         *  content in that encoding is sent the selected one.
+         */
+        bool isCurrent(std::string_view ifNoneMatch, Encoding encoding) const;
+    };
+
+    AssetBundle() = default;
+    AssetBundle(std::string indexHtml);
+    AssetBundle(const char* indexHtml);
+
+    /**
+     *  Serves content at path, which starts with '/'. The content type follows
+     *  from the extension of path. HTML is sent with `Cache-Control: no-cache`
+     *  so browsers revalidate it and pick up a new page right away, the assets
+     *  it refers to may be cached for an hour.
+     */
+    void add(std::string path, std::string content);
+
+    /**
+     *  The asset for the target of a request, nullptr if there is none.
+     *  Targets ending in '/' and, as before assets were bundled, any target
+     *  ending in `/index.html` serve `/index.html`.
+     */
+    const Asset* find(std::string_view target) const;
+
+private:
+    std::unordered_map<std::string, Asset> assets;
+};
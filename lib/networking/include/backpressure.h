@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ *  Bounds on the text queued for a connection that its Client has not read
+ *  yet. A connection becomes congested once its queue grows past either high
+ *  watermark and stays congested until the queue is back under both low
+ *  watermarks. While a connection is congested, chat messages (see Priority)
+ *  sent to it are dropped along with the chat messages it still has queued,
+ *  and the Client is told how many it missed once the congestion clears. A
+ *  connection that is still congested after gracePeriod is disconnected.
+ */
+struct Backpressure {
+    size_t highWatermarkBytes = 4 << 20;
+    size_t highWatermarkMessages = 4096;
+    size_t lowWatermarkBytes = 1 << 20;
+    size_t lowWatermarkMessages = 1024;
+    std::chrono::milliseconds gracePeriod{10000};
+};
+
+/**
+ *  The text queued for a connection that its Client has not read yet,
+ *  see Server::queuedWrites().
+ */
+struct QueuedWrites {
+    size_t bytes = 0;
+    size_t messages = 0;
+};
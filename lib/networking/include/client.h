@@ -1,5 +1,8 @@
 #pragma once
 
+#include "compression.h"
+#include "protocol.h"
+
 #include <memory>
 #include <string>
 
@@ -19,9 +22,12 @@ class Client {
 public:
     /**
      *  Construct a Client and acquire a connection to a remote Server at the
-     *  given address and port.
+     *  given address and port. compression offers permessage-deflate to the Server.
+     *  With the binary protocol, messages sent and received are sequences of frames
+     *  (see Protocol).
      */
-    Client(std::string_view address, std::string_view port);
+    Client(std::string_view address, std::string_view port, Compression compression = {},
+           Protocol protocol = Protocol::Text);
 
     /** Out of line default constructor for compilation firewall. */
     ~Client();
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ *  Settings of the websocket permessage-deflate extension (RFC 7692), used by
+ *  the Server and the Client. Messages are only compressed on connections where
+ *  both ends enabled it, otherwise the connection falls back to plain text.
+ *  - windowBits : LZ77 window as a power of two (9..15), smaller windows need
+ *    less memory per connection and compress less
+ *  - level : deflate level (0..9), higher levels trade CPU for bandwidth
+ *  - memLevel : deflate memory level (1..9)
+ *  - noContextTakeover : compress every message on its own instead of with the
+ *    history of the previous messages, so connections do not keep a window
+ *    between messages at the cost of a lower ratio on repetitive text
+ */
+struct Compression {
+    bool enabled = false;
+    int windowBits = 15;
+    int level = 6;
+    int memLevel = 4;
+    bool noContextTakeover = false;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ *  Detection of dead connections by the Server. A connection that has not sent
+ *  anything for pingInterval is sent a websocket ping, a connection that has
+ *  not sent anything, a pong included, for idleTimeout is disconnected. Both
+ *  are checked by one timer wheel per I/O thread, so a connection is found
+ *  dead at most idleTimeout / 8 after it timed out. An idleTimeout of 0
+ *  disables the checks.
+ */
+struct Keepalive {
+    std::chrono::milliseconds pingInterval{15000};
+    std::chrono::milliseconds idleTimeout{60000};
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ *  How the Server accepts connections.
+ *  - pendingAccepts : accepts kept outstanding on each listening socket, so a
+ *    burst of connections, e.g. every Client reconnecting after a restart, is
+ *    taken several at a time instead of one per turn of the event loop
+ *  - acceptorPerThread : with I/O threads, every thread listens on its own
+ *    socket bound with SO_REUSEPORT and the kernel spreads the connections
+ *    over them. Otherwise one socket accepts for all threads. Note that other
+ *    processes of the same user listening with SO_REUSEPORT share the port.
+ *  - backlog : connections the kernel queues per listening socket until
+ *    they are accepted
+ */
+struct Listening {
+    unsigned pendingAccepts = 16;
+    bool acceptorPerThread = true;
+    int backlog = 1024;
+};
+
+/**
+ *  Connections accepted and accepts that failed since the Server started, see
+ *  Server::acceptStats(). Rates are the difference between two snapshots.
+ */
+struct AcceptStats {
+    uint64_t accepted = 0;
+    uint64_t failed = 0;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "cacheLine.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ *  A count that only goes up, e.g. the messages received since the Server started.
+ *  Counters and gauges sit on their own cache line, so threads updating different
+ *  metrics do not slow each other down.
+ */
+class alignas(CACHE_LINE_SIZE) Counter {
+public:
+    void add(uint64_t amount = 1) noexcept { count.fetch_add(amount, std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t value() const noexcept { return count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> count{0};
+};
+
+
+/**
+ *  A value that goes up and down, e.g. the open connections.
+ */
+class alignas(CACHE_LINE_SIZE) Gauge {
+public:
+    void set(int64_t value) noexcept { current.store(value, std::memory_order_relaxed); }
+    void add(int64_t amount) noexcept { current.fetch_add(amount, std::memory_order_relaxed); }
+    [[nodiscard]] int64_t value() const noexcept { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> current{0};
+};
+
+
+/**
+ *  The distribution of integer samples, e.g. durations in microseconds. The buckets
+ *  are log-linear like those of an HDR histogram: samples below SUB_BUCKETS have a
+ *  bucket each, above that every power of two is split into SUB_BUCKETS buckets. A
+ *  sample is thus known within 1/SUB_BUCKETS of its value over the whole range, at a
+ *  fixed size and without configuring bucket bounds. Samples of MAX_BITS bits or more
+ *  land in the last bucket. Recording a sample is a few relaxed atomic additions.
+ */
+class Histogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_BITS = 40;
+    static constexpr size_t NUM_BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t value) noexcept {
+        buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static size_t bucketOf(uint64_t value) noexcept;
+
+    /**
+     *  The largest sample that lands in bucket.
+     */
+    static uint64_t upperBound(size_t bucket) noexcept;
+
+    [[nodiscard]] uint64_t bucketCount(size_t bucket) const noexcept {
+        return buckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t count() const noexcept;
+    [[nodiscard]] uint64_t sum() const noexcept { return total.load(std::memory_order_relaxed); }
+
+    /**
+     *  The upper bound of the bucket holding the sample at quantile (0 to 1) of the
+     *  samples recorded so far, 0 without samples.
+     */
+    [[nodiscard]] uint64_t quantile(double quantile) const noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> total{0};
+};
+
+
+/**
+ *  Records the microseconds from its construction to its destruction into a Histogram.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) noexcept
+        : histogram{histogram},
+        start{std::chrono::steady_clock::now()}
+    { }
+
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+
+/**
+ *  The metrics of a process, exported in the Prometheus text format (see exposition()).
+ *  A Server serves the metrics registered with it at `/metrics` (see Server::metrics()).
+ *
+ *  Metrics are registered once, up front, and then updated through the references
+ *  handed out, from any thread and without locks. Registering a name and labels
+ *  again returns the metric registered first, registering a name again as another
+ *  type throws std::logic_error. labels are preformatted, e.g.
+ *  `command="join"`, and empty for a metric without labels. The unit of a histogram
+ *  converts its samples to the base unit of the metric, e.g. 1e-6 for samples in
+ *  microseconds of a metric in seconds.
+ */
+class Metrics {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, double unit,
+                         const std::string& labels = {});
+
+    /**
+     *  The current value of every metric, in the Prometheus text exposition format.
+     *  Histograms list a bucket per power of two up to their largest sample.
+     */
+    [[nodiscard]] std::string exposition() const;
+
+private:
+    enum class Type {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        double unit = 1;
+        std::vector<Series> series;
+    };
+
+    /**
+     *  Finds or adds the series of name with labels, called with mutex held. The
+     *  series may move when another one is added, the metric it holds does not.
+     */
+    Series& series(const std::string& name, const std::string& help, const std::string& labels,
+                   Type type, double unit);
+
+    mutable std::mutex mutex; // guards the registration, not the values
+    std::map<std::string, Family> families;
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ *  The wire format of a connection, chosen by the Client in its websocket
+ *  handshake. Clients that offer BINARY_SUBPROTOCOL in Sec-WebSocket-Protocol
+ *  use the binary protocol, every other Client, e.g. the web chat and the
+ *  terminal client, uses the text protocol.
+ *  - Text : commands are typed out and the Server answers with preformatted text
+ *  - Binary : every websocket message is a sequence of frames. Commands and input
+ *    choices arrive as opcodes with fields, the Server sends structured events
+ *    that Clients render themselves instead of parsing text.
+ */
+enum class Protocol : uint8_t {
+    Text,
+    Binary
+};
+
+constexpr std::string_view BINARY_SUBPROTOCOL = "socialgaming.binary.v1";
+
+
+/////////////////////       BINARY PROTOCOL       /////////////////////
+
+/**
+ *  A frame is its opcode (1 byte), the size of its fields (4 bytes) and the fields.
+ *  Integers are little endian, a string is its size (2 bytes) and its bytes, a
+ *  list is its size (2 bytes) and its items. A field marked "rest" takes the
+ *  remainder of the frame.
+ */
+enum class Opcode : uint8_t {
+    // Client to Server
+    Command = 0x01,   // u8 CommandCode, then the arguments as strings
+    Choice = 0x02,    // u32 index of the chosen option of the pending prompt
+    Input = 0x03,     // rest: text, e.g. a lobby chat line or a text answer
+
+    // Server to Client
+    Text = 0x81,      // rest: preformatted text, sent for output without a structured form
+    Prompt = 0x82,    // u32 timeout in ms (0 without one), string question, list of strings choices
+    Scores = 0x83,    // list of strings columns, list of rows: string player, one i32 per column
+    GameState = 0x84, // u8 GameStateChange, u64 invitation code of the game
+};
+
+/**
+ *  The commands of the binary protocol, fixed on the wire independently of
+ *  the order of the commands within the Server.
+ */
+enum class CommandCode : uint8_t {
+    Exit,
+    Help,
+    Games,
+    Create,
+    Join,
+    Start,
+    Leave,
+    End,
+    Name,
+    Room,
+    Queue,
+};
+
+enum class GameStateChange : uint8_t {
+    Started,
+    Finished,
+    Ended,
+};
+
+
+/**
+ *  Appends one frame to out. The fields are written in order between the
+ *  constructor and finish(), which fills in their size.
+ */
+class FrameWriter {
+public:
+    FrameWriter(std::string& out, Opcode opcode)
+        : out{out} {
+        out.push_back(static_cast<char>(opcode));
+        sizeAt = out.size();
+        out.append(4, '\0');
+    }
+
+    void u8(uint8_t value)   { integer(value, 1); }
+    void u16(uint16_t value) { integer(value, 2); }
+    void u32(uint32_t value) { integer(value, 4); }
+    void u64(uint64_t value) { integer(value, 8); }
+    void i32(int32_t value)  { integer(static_cast<uint32_t>(value), 4); }
+
+    /**
+     *  Strings longer than a string field can hold are cut short.
+     */
+    void string(std::string_view value) {
+        value = value.substr(0, UINT16_MAX);
+        u16(static_cast<uint16_t>(value.size()));
+        out.append(value);
+    }
+
+    void rest(std::string_view value) { out.append(value); }
+
+    void finish() {
+        uint64_t size = out.size() - sizeAt - 4;
+        for (size_t i = 0; i < 4; i++) {
+            out[sizeAt + i] = static_cast<char>(size >> (8 * i));
+        }
+    }
+
+private:
+    void integer(uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    std::string& out;
+    size_t sizeAt;
+};
+
+
+/**
+ *  Reads the fields of a frame. Every read returns false, and leaves value
+ *  untouched, if the frame is too short to hold the field. Strings view the
+ *  frame rather than copying it.
+ */
+class FieldReader {
+public:
+    explicit FieldReader(std::string_view fields)
+        : fields{fields}
+    { }
+
+    bool u8(uint8_t& value)   { return integer(value, 1); }
+    bool u16(uint16_t& value) { return integer(value, 2); }
+    bool u32(uint32_t& value) { return integer(value, 4); }
+    bool u64(uint64_t& value) { return integer(value, 8); }
+
+    bool string(std::string_view& value) {
+        FieldReader reader = *this;
+        uint16_t size;
+        if (!reader.u16(size) || reader.fields.size() < size) {
+            return false;
+        }
+        value = reader.fields.substr(0, size);
+        fields = reader.fields.substr(size);
+        return true;
+    }
+
+    std::string_view rest() {
+        auto value = fields;
+        fields = {};
+        return value;
+    }
+
+    bool empty() const { return fields.empty(); }
+
+private:
+    template <typename T>
+    bool integer(T& value, size_t bytes) {
+        if (fields.size() < bytes) {
+            return false;
+        }
+        uint64_t result = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            result |= static_cast<uint64_t>(static_cast<unsigned char>(fields[i])) << (8 * i);
+        }
+        value = static_cast<T>(result);
+        fields.remove_prefix(bytes);
+        return true;
+    }
+
+    std::string_view fields;
+};
+
+
+/**
+ *  Splits a websocket message of the binary protocol into its frames. Returns
+ *  false once there are no frames left or the next one is truncated.
+ */
+inline bool nextFrame(std::string_view& message, Opcode& opcode, std::string_view& fields) {
+    FieldReader header{message};
+    uint8_t code;
+    uint32_t size;
+    if (!header.u8(code) || !header.u32(size) || message.size() - 5 < size) {
+        return false;
+    }
+    opcode = static_cast<Opcode>(code);
+    fields = message.substr(5, size);
+    message.remove_prefix(5 + size);
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ *  Bounds how fast each Client may send, so one Client flooding the Server
+ *  cannot slow the game logic down for everyone else. Every connection has a
+ *  token bucket holding up to burst tokens, refilled at messagesPerSecond.
+ *  Every message takes a token, a message arriving at an empty bucket is read
+ *  and dropped before it is queued for the Server. A message of the binary
+ *  protocol takes a token per frame, the frames that find the bucket empty are
+ *  dropped and count as a dropped message each. A Client that sends
+ *  maxDroppedInARow messages or frames into an empty bucket without a message
+ *  getting through whole in between is disconnected.
+ *  - messagesPerSecond : 0 disables the limit
+ *  - maxDroppedInARow : 0 drops excess messages without ever disconnecting
+ */
+struct RateLimit {
+    double messagesPerSecond = 20;
+    double burst = 40;
+    unsigned maxDroppedInARow = 200;
+};
+
+/**
+ *  Messages (frames for the binary protocol) dropped and Clients disconnected
+ *  by the RateLimit since the Server started, see Server::rateLimitStats().
+ */
+struct RateLimitStats {
+    uint64_t dropped = 0;
+    uint64_t disconnected = 0;
+};
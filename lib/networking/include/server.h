@@ -1,5 +1,15 @@
 #pragma once
 
+#include "assetBundle.h"
+#include "backpressure.h"
+#include "compression.h"
+#include "keepalive.h"
+#include "listening.h"
+#include "metrics.h"
+#include "protocol.h"
+#include "rateLimit.h"
+
+#include <cstdint>
 #include <deque>
 #include <string>
 #include <memory>
@@ -7,10 +17,27 @@
 /**
  *  An identifier for a Client connected to a Server. The ID of a User is
  *  guaranteed to be unique across all actively connected Client instances.
+ *
+ *  IDs are dense: the low 32 bits are a slot, which is handed to another
+ *  Client once this one disconnects, and the high 32 bits are the generation
+ *  of the slot, which changes every time the slot is reused. Per-user state
+ *  can therefore be kept in flat tables indexed by slot (see UserTable), and
+ *  the ID of a disconnected Client never matches the Client that took over
+ *  its slot.
  */
 struct User {
     uintptr_t id;
 
+    uint32_t slot() const {
+        return static_cast<uint32_t>(id);
+    }
+    uint32_t generation() const {
+        return static_cast<uint32_t>(static_cast<uint64_t>(id) >> 32);
+    }
+    static User fromSlot(uint32_t slot, uint32_t generation) {
+        return User{static_cast<uintptr_t>((static_cast<uint64_t>(generation) << 32) | slot)};
+    }
+
     bool operator==(User other) const {
         return id == other.id;
     }
@@ -27,13 +54,77 @@ struct UserHash {
 };
 
 
+/**
+ *  Text that is built once and then sent to any number of Users without being
+ *  copied, e.g. fixed responses or a broadcast. A Payload is never modified
+ *  after it is built, so it can be shared across threads.
+ */
+using Payload = std::shared_ptr<const std::string>;
+
+inline Payload makePayload(std::string text) {
+    return std::make_shared<const std::string>(std::move(text));
+}
+
+
+/**
+ *  The class of an outgoing Message. A connection writes the queued Messages
+ *  of a higher class before those of a lower class, Messages of the same class
+ *  are written in the order they were sent.
+ *  - Critical : text the User has to act on in time, e.g. an input prompt
+ *  - Informational : everything else a game or a command responds with
+ *  - Chat : lobby chat, dropped rather than queued when the connection of the
+ *    User is congested (see Backpressure)
+ */
+enum class Priority : uint8_t {
+    Critical,
+    Informational,
+    Chat
+};
+
+
 /**
  *  A Message containing text that can be sent to or was recieved from a given
- *  User.
+ *  User. An outgoing Message with a payload sends the payload instead of text.
+ *
+ *  Users of the binary protocol are sent the event of an outgoing Message, frames
+ *  encoding the same content in structured form (see Protocol). Messages without
+ *  an event reach them as a Text frame. The text of an incoming Message of the
+ *  binary protocol holds the frames the Client sent.
  */
 struct Message {
     User user;
     std::string text;
+    Payload payload{};
+    Priority priority = Priority::Informational;
+    Payload event{};
+    Protocol protocol = Protocol::Text;
+};
+
+
+/**
+ *  How a Server runs its connections, every option defaults to the behavior
+ *  described with it. Callers set the options they change, e.g.
+ *      ServerOptions options;
+ *      options.ioThreads = 2;
+ *      options.compression.enabled = true;
+ *  - ioThreads : the number of threads performing network I/O. With 0, the
+ *    I/O is performed by Server::update() on the thread using the Server
+ *  - compression : enables permessage-deflate for Clients that offer it
+ *  - backpressure : bounds the text queued for each connection, Clients that
+ *    do not keep up with it are disconnected (see Backpressure)
+ *  - keepalive : pings idle connections and disconnects those that stay silent,
+ *    so Clients that vanished without closing are released (see Keepalive)
+ *  - listening : how many connections are accepted at once and by which
+ *    threads (see Listening)
+ *  - rateLimit : bounds how fast each Client may send (see RateLimit)
+ */
+struct ServerOptions {
+    unsigned ioThreads = 0;
+    Compression compression{};
+    Backpressure backpressure{};
+    Keepalive keepalive{};
+    Listening listening{};
+    RateLimit rateLimit{};
 };
 
 
@@ -47,17 +138,20 @@ struct ServerImplDeleter {
 /**
  *  @class Server
  *
- *  @brief A single threaded network server for transferring text.
+ *  @brief A network server for transferring text.
  *
  *  The Server class transfers text to and from multiple Client instances
- *  connected on a given port. The behavior is single threaded, so all transfer
- *  operations are grouped and performed on the next call to Server::update().
+ *  connected on a given port. By default the behavior is single threaded, so
+ *  all transfer operations are grouped and performed on the next call to
+ *  Server::update(). With I/O threads the connections are spread over those
+ *  threads and transfers happen as soon as possible, the thread using the
+ *  Server exchanges messages with them over lock-free queues.
  *  Text can be sent to the Server using Client::send() and received from the
  *  Server using Client::receive().
  *
- *  The Server is websocket based and supports sending a single file back in
- *  response to HTTP requests for `index.html`. This allows command line and
- *  web clients to interact.
+ *  The Server is websocket based and supports sending files back in response
+ *  to HTTP requests, e.g. `index.html`. This allows command line and web
+ *  clients to interact.
  */
 class Server {
 public:
@@ -74,25 +168,40 @@ public:
    *  contains an ID that is guaranteed to be unique across all active
    *  connections.
    *
-   *  The httpMessage is a string containing HTML content that will be sent
-   *  in response to standard HTTP requests for any path ending in `index.html`.
+   *  The assets are sent in response to standard HTTP requests, a string
+   *  containing HTML content is served for any path ending in `index.html`
+   *  (see AssetBundle).
+   *
+   *  options sets the I/O threads, compression and the limits of the
+   *  connections (see ServerOptions). With or without I/O threads the
+   *  callbacks are only called from Server::update(), Server::receive() and
+   *  Server::disconnect().
+   *
+   *  The Server counts its connections and the messages and bytes it moves,
+   *  and serves these along with any other metrics registered with it at
+   *  `/metrics` (see Server::metrics()).
    */
     template <typename C, typename D>
-    Server(unsigned short port, std::string httpMessage, C onConnect, D onDisconnect)
+    Server(unsigned short port, AssetBundle assets, C onConnect, D onDisconnect,
+           const ServerOptions& options = {})
         : connectionHandler{std::make_unique<ConnectionHandlerImpl<C,D>>(onConnect, onDisconnect)},
-        impl{buildImpl(*this, port, std::move(httpMessage))} 
+        impl{buildImpl(*this, port, std::move(assets), options)} 
     { }
 
     /**
      *  Perform all pending sends and receives. This function can throw an
      *  exception if any of the I/O operations encounters an error.
+     *  With I/O threads, this only hands pending sends to the I/O threads and
+     *  reports the connections and disconnections they observed.
      */
     void update();
 
     /**
-     *  Send a list of messages to their respective Clients.
+     *  Send a list of messages to their respective Clients. The text of each
+     *  message is moved all the way to the connection that writes it, so
+     *  messages is left empty.
      */
-    void send(const std::deque<Message>& messages);
+    void send(std::deque<Message>&& messages);
 
     /**
      *  Receive Messages from Clients. Returns all Messages collected 
@@ -105,6 +214,28 @@ public:
      */
     void disconnect(User user);
 
+    /**
+     *  The text queued for the Client specified by the given User that it has
+     *  not read yet. Nothing is queued for Users that are not connected.
+     */
+    [[nodiscard]] QueuedWrites queuedWrites(User user) const;
+
+    /**
+     *  The connections accepted so far and the accepts that failed.
+     */
+    [[nodiscard]] AcceptStats acceptStats() const;
+
+    /**
+     *  The messages dropped and the Clients disconnected for sending too fast.
+     */
+    [[nodiscard]] RateLimitStats rateLimitStats() const;
+
+    /**
+     *  The registry of the metrics served at `/metrics`. Other parts of the
+     *  process register their metrics here to have them served too.
+     */
+    [[nodiscard]] Metrics& metrics();
+
 private:
     friend class ServerImpl;
 
@@ -135,7 +266,7 @@ private:
     };
 
     static std::unique_ptr<ServerImpl,ServerImplDeleter>
-    buildImpl(Server& server, unsigned short port, std::string httpMessage);
+    buildImpl(Server& server, unsigned short port, AssetBundle assets, const ServerOptions& options);
 
     std::unique_ptr<ConnectionHandler> connectionHandler;
     std::unique_ptr<ServerImpl,ServerImplDeleter> impl;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ *  Times the phases of a loop that runs in ticks, e.g. the main loop of the game
+ *  server, to tell which phase a latency spike comes from. A tick is bracketed by
+ *  beginTick() and endTick(), the phases within it are timed with measure() or
+ *  time(). A phase may run several times per tick, its time is summed.
+ *
+ *  Every tick records the time of each phase that ran into a histogram of that
+ *  phase, and the time of the whole tick into the tick histogram. The histograms
+ *  are registered with the given Metrics, so they are also served at `/metrics`.
+ *  Ticks taking longer than budget are counted and kept for describeLastTick(),
+ *  the slowest tick is kept for dump().
+ *
+ *  The phases are timed with steady_clock, a monotonic clock read without a
+ *  system call on Linux, so timing a phase costs two clock reads.
+ *  A TickProfiler is used from a single thread.
+ */
+class TickProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TickProfiler(Metrics& metrics, std::chrono::microseconds budget);
+
+    /**
+     *  Adds a phase named name, returns the phase to pass to measure() and time().
+     */
+    size_t addPhase(const std::string& name);
+
+    /**
+     *  Times phase from its construction to its destruction.
+     */
+    class Scope {
+    public:
+        Scope(TickProfiler& profiler, size_t phase) noexcept
+            : profiler{profiler},
+            phase{phase},
+            start{Clock::now()}
+        { }
+
+        ~Scope() {
+            profiler.phases[phase].elapsed += Clock::now() - start;
+            profiler.phases[phase].ran = true;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        TickProfiler& profiler;
+        size_t phase;
+        Clock::time_point start;
+    };
+
+    [[nodiscard]] Scope measure(size_t phase) noexcept { return Scope{*this, phase}; }
+
+    /**
+     *  Calls function as phase, returns what it returns.
+     */
+    template <typename Function>
+    decltype(auto) time(size_t phase, Function&& function) {
+        Scope scope{*this, phase};
+        return function();
+    }
+
+    void beginTick();
+
+    /**
+     *  Records the tick. Returns true if it took longer than the budget.
+     */
+    bool endTick();
+
+    /**
+     *  The time of the last tick and of its phases, e.g.
+     *  `tick 12 took 61.250 ms (budget 50.000 ms): server.update 60.875 ms, ...`
+     */
+    [[nodiscard]] std::string describeLastTick() const;
+
+    /**
+     *  A table of the time of every phase and of the ticks since the start, with
+     *  the mean, median, 99th percentile and maximum of each, followed by the
+     *  slowest tick. The percentiles and maxima are those of the histograms, so
+     *  they are rounded up by up to an eighth.
+     */
+    [[nodiscard]] std::string dump() const;
+
+private:
+    struct Phase {
+        std::string name;
+        Histogram& histogram;
+        Clock::duration elapsed{}; // within the current tick
+        bool ran = false;          // within the current tick
+    };
+
+    /**
+     *  The time of a tick and of the phases that ran in it.
+     */
+    struct TickRecord {
+        uint64_t tick = 0;
+        Clock::duration elapsed{};
+        std::vector<std::pair<size_t, Clock::duration>> phases;
+    };
+
+    std::string describe(const TickRecord& record) const;
+
+    std::chrono::microseconds budget;
+    std::vector<Phase> phases;
+    Histogram& tickDuration;
+    Counter& ticksOverBudget;
+    Metrics& metrics;
+
+    Clock::time_point tickStart;
+    uint64_t ticks = 0;
+    TickRecord lastTick;
+    TickRecord slowestTick;
+};
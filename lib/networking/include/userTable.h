@@ -0,0 +1,82 @@
+#pragma once
+
+#include "server.h"
+
+#include <vector>
+
+/**
+ *  Per-user state kept in a flat vector indexed by User::slot().
+ *
+ *  A lookup is a bounds check and an index, with no hashing. Every entry remembers
+ *  the full User it belongs to, so the state left behind by a disconnected User is
+ *  never returned for the User that reuses its slot, and is replaced when that User
+ *  adds its own.
+ */
+template <typename T>
+class UserTable {
+public:
+    /**
+     *  Returns the state of user, or nullptr if user has none.
+     */
+    T* find(User user) {
+        if (user.slot() >= entries.size()) {
+            return nullptr;
+        }
+        Entry& entry = entries[user.slot()];
+        return entry.used && entry.user == user ? &entry.value : nullptr;
+    }
+
+    const T* find(User user) const {
+        return const_cast<UserTable*>(this)->find(user);
+    }
+
+    bool contains(User user) const {
+        return find(user) != nullptr;
+    }
+
+    /**
+     *  Returns the state of user, default constructing it if user has none.
+     */
+    T& operator[](User user) {
+        if (user.slot() >= entries.size()) {
+            entries.resize(user.slot() + 1);
+        }
+        Entry& entry = entries[user.slot()];
+        if (!entry.used) {
+            entry.used = true;
+            count++;
+        } else if (!(entry.user == user)) {
+            entry.value = T{}; // stale state of the previous user of the slot
+        }
+        entry.user = user;
+        return entry.value;
+    }
+
+    /**
+     *  Drops the state of user, returns false if user had none.
+     */
+    bool erase(User user) {
+        if (find(user) == nullptr) {
+            return false;
+        }
+        Entry& entry = entries[user.slot()];
+        entry.used = false;
+        entry.value = T{};
+        count--;
+        return true;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    struct Entry {
+        User user{0};
+        bool used = false;
+        T value{};
+    };
+
+    std::vector<Entry> entries;
+    size_t count = 0;
+};
@@ -0,0 +1,257 @@
+#include "assetBundle.h"
+
+#include <zlib.h>
+#ifdef HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+using namespace std::string_view_literals;
+
+
+namespace {
+
+constexpr auto INDEX = "/index.html"sv;
+
+
+std::string_view
+trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+
+bool
+equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size()
+        && std::equal(a.begin(), a.end(), b.begin(), [] (char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+}
+
+
+bool
+endsWith(std::string_view text, std::string_view suffix) {
+    return suffix.size() <= text.size()
+        && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+
+// Calls visit with every element of a comma separated header value
+template <typename Visit>
+void
+forEachElement(std::string_view header, Visit visit) {
+    while (!header.empty()) {
+        auto comma = header.find(',');
+        auto element = trim(header.substr(0, comma));
+        if (!element.empty()) {
+            visit(element);
+        }
+        header.remove_prefix(comma == std::string_view::npos ? header.size() : comma + 1);
+    }
+}
+
+
+// True if the Accept-Encoding header lists coding, or *, without q=0
+bool
+accepts(std::string_view acceptEncoding, std::string_view coding) {
+    bool accepted = false;
+    forEachElement(acceptEncoding, [&] (std::string_view element) {
+        auto semicolon = element.find(';');
+        auto name = trim(element.substr(0, semicolon));
+        if (!equalsIgnoreCase(name, coding) && name != "*") {
+            return;
+        }
+        if (semicolon == std::string_view::npos) {
+            accepted = true;
+            return;
+        }
+        auto weight = trim(element.substr(semicolon + 1));
+        if (weight.size() < 2 || std::tolower(static_cast<unsigned char>(weight[0])) != 'q' || weight[1] != '=') {
+            accepted = true;
+            return;
+        }
+        weight.remove_prefix(2);
+        accepted = weight.find_first_not_of("0.") != std::string_view::npos;
+    });
+    return accepted;
+}
+
+
+// FNV-1a, stable across restarts so ETags stay valid when the server is restarted
+std::string
+makeETag(std::string_view content, std::string_view suffix) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : content) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return "\"" + std::string{hex} + std::string{suffix} + "\"";
+}
+
+
+std::string
+gzip(std::string_view content) {
+    z_stream stream{};
+    // 16 added to the window bits selects the gzip wrapper
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {};
+    }
+    std::string compressed(deflateBound(&stream, content.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+    stream.avail_in = content.size();
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = compressed.size();
+    auto result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? compressed : std::string{};
+}
+
+
+std::string
+brotli([[maybe_unused]] std::string_view content) {
+#ifdef HAS_BROTLI
+    size_t size = BrotliEncoderMaxCompressedSize(content.size());
+    if (size == 0) {
+        return {};
+    }
+    std::string compressed(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               content.size(), reinterpret_cast<const uint8_t*>(content.data()),
+                               &size, reinterpret_cast<uint8_t*>(compressed.data()))) {
+        return {};
+    }
+    compressed.resize(size);
+    return compressed;
+#else
+    return {};
+#endif
+}
+
+
+std::string
+contentTypeOf(std::string_view path) {
+    constexpr std::pair<std::string_view, std::string_view> TYPES[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".js",   "application/javascript; charset=utf-8"},
+        {".css",  "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".svg",  "image/svg+xml"},
+        {".png",  "image/png"},
+        {".ico",  "image/x-icon"},
+        {".txt",  "text/plain; charset=utf-8"},
+    };
+    for (auto [extension, type] : TYPES) {
+        if (endsWith(path, extension)) {
+            return std::string{type};
+        }
+    }
+    return "application/octet-stream";
+}
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Assets
+/////////////////////////////////////////////////////////////////////////////
+
+
+AssetBundle::Encoding
+AssetBundle::Asset::selectEncoding(std::string_view acceptEncoding) const {
+    // brotli is tried first, it compresses text better than gzip
+    constexpr std::pair<Encoding, std::string_view> PREFERENCE[] = {
+        {Encoding::Brotli, "br"},
+        {Encoding::Gzip, "gzip"},
+    };
+    for (auto [encoding, coding] : PREFERENCE) {
+        if (!variants[static_cast<size_t>(encoding)].etag.empty() && accepts(acceptEncoding, coding)) {
+            return encoding;
+        }
+    }
+    return Encoding::Identity;
+}
+
+
+bool
+AssetBundle::Asset::isCurrent(std::string_view ifNoneMatch, Encoding encoding) const {
+    const std::string& selected = variants[static_cast<size_t>(encoding)].etag;
+    bool current = false;
+    forEachElement(ifNoneMatch, [&] (std::string_view etag) {
+        // If-None-Match uses the weak comparison, which ignores the W/ prefix
+        if (etag.substr(0, 2) == "W/") {
+            etag.remove_prefix(2);
+        }
+        current = current || etag == "*" || etag == selected;
+    });
+    return current;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Bundle
+/////////////////////////////////////////////////////////////////////////////
+
+
+AssetBundle::AssetBundle(std::string indexHtml) {
+    add(std::string{INDEX}, std::move(indexHtml));
+}
+
+
+AssetBundle::AssetBundle(const char* indexHtml)
+    : AssetBundle{std::string{indexHtml}}
+{ }
+
+
+void
+AssetBundle::add(std::string path, std::string content) {
+    Asset asset;
+    asset.contentType = contentTypeOf(path);
+    asset.cacheControl = endsWith(path, ".html") ? "no-cache" : "public, max-age=3600";
+
+    auto& identity = asset.variants[static_cast<size_t>(Encoding::Identity)];
+    identity.etag = makeETag(content, "");
+
+    constexpr std::pair<Encoding, std::string_view> COMPRESSED[] = {
+        {Encoding::Gzip, "-gz"},
+        {Encoding::Brotli, "-br"},
+    };
+    for (auto [encoding, suffix] : COMPRESSED) {
+        auto body = encoding == Encoding::Gzip ? gzip(content) : brotli(content);
+        if (!body.empty() && body.size() < content.size()) {
+            auto& variant = asset.variants[static_cast<size_t>(encoding)];
+            variant.body = std::move(body);
+            variant.etag = makeETag(content, suffix);
+        }
+    }
+
+    identity.body = std::move(content);
+    assets[std::move(path)] = std::move(asset);
+}
+
+
+const AssetBundle::Asset*
+AssetBundle::find(std::string_view target) const {
+    // the query does not select the asset
+    target = target.substr(0, target.find('?'));
+
+    std::string path{target};
+    if (endsWith(path, "/")) {
+        path += INDEX.substr(1);
+    }
+    auto found = assets.find(path);
+    if (found == assets.end() && endsWith(path, INDEX)) {
+        found = assets.find(std::string{INDEX});
+    }
+    return found == assets.end() ? nullptr : &found->second;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <boost/beast/core/flat_buffer.hpp>
+
+/**
+ *  Read buffers shared by the Channels of an IOWorker. A buffer is taken from the free
+ *  list of the smallest size class that fits the message being read and given back once
+ *  the message was handed off, so memory is only held for reads in progress. Buffers that
+ *  grew past the largest size class, or that a full free list has no room for, are freed.
+ *  The pool is not thread safe, it is only used by the thread running its IOWorker.
+ */
+class BufferPool {
+public:
+    using Buffer = std::unique_ptr<boost::beast::flat_buffer>;
+
+    static constexpr std::array<size_t, 3> SIZE_CLASSES = {1 << 10, 1 << 14, 1 << 18};
+    static constexpr size_t FREE_BUFFERS_PER_CLASS = 64;
+
+    Buffer acquire(size_t size) {
+        for (size_t sizeClass = classFor(size); sizeClass < SIZE_CLASSES.size(); sizeClass++) {
+            if (!freeBuffers[sizeClass].empty()) {
+                Buffer buffer = std::move(freeBuffers[sizeClass].back());
+                freeBuffers[sizeClass].pop_back();
+                return buffer;
+            }
+        }
+        auto buffer = std::make_unique<boost::beast::flat_buffer>();
+        size_t sizeClass = classFor(size);
+        buffer->reserve(sizeClass < SIZE_CLASSES.size() ? SIZE_CLASSES[sizeClass] : size);
+        return buffer;
+    }
+
+    void release(Buffer buffer) {
+        buffer->clear();
+        // the largest class the buffer can serve
+        size_t capacity = buffer->capacity();
+        if (capacity < SIZE_CLASSES.front() || SIZE_CLASSES.back() < capacity) {
+            return;
+        }
+        size_t sizeClass = SIZE_CLASSES.size() - 1;
+        while (capacity < SIZE_CLASSES[sizeClass]) {
+            sizeClass--;
+        }
+        if (freeBuffers[sizeClass].size() < FREE_BUFFERS_PER_CLASS) {
+            freeBuffers[sizeClass].push_back(std::move(buffer));
+        }
+    }
+
+private:
+    static size_t classFor(size_t size) {
+        size_t sizeClass = 0;
+        while (sizeClass < SIZE_CLASSES.size() && SIZE_CLASSES[sizeClass] < size) {
+            sizeClass++;
+        }
+        return sizeClass;
+    }
+
+    std::array<std::vector<Buffer>, SIZE_CLASSES.size()> freeBuffers;
+};
+
+
+/**
+ *  The dynamic buffer a Channel reads into. It holds no memory until the websocket stream
+ *  prepares room for a message, at which point it borrows a buffer from the pool, and it
+ *  gives the buffer back on release(). An idle Channel waiting for its next message
+ *  therefore holds no read buffer.
+ */
+class PooledReadBuffer {
+public:
+    using const_buffers_type = boost::beast::flat_buffer::const_buffers_type;
+    using mutable_buffers_type = boost::beast::flat_buffer::mutable_buffers_type;
+
+    explicit PooledReadBuffer(BufferPool& pool)
+        : pool{pool}
+    { }
+
+    PooledReadBuffer(const PooledReadBuffer&) = delete;
+    PooledReadBuffer& operator=(const PooledReadBuffer&) = delete;
+
+    ~PooledReadBuffer() {
+        release();
+    }
+
+    void release() {
+        if (buffer) {
+            pool.release(std::move(buffer));
+        }
+    }
+
+    // DynamicBuffer
+
+    size_t size() const noexcept { return buffer ? buffer->size() : 0; }
+    size_t max_size() const noexcept { return buffer ? buffer->max_size() : MAX_SIZE; }
+    size_t capacity() const noexcept { return buffer ? buffer->capacity() : 0; }
+
+    const_buffers_type data() const noexcept {
+        return buffer ? buffer->data() : const_buffers_type{};
+    }
+
+    const_buffers_type cdata() const noexcept {
+        return data();
+    }
+
+    mutable_buffers_type prepare(size_t n) {
+        if (!buffer) {
+            buffer = pool.acquire(n);
+        }
+        return buffer->prepare(n);
+    }
+
+    void commit(size_t n) noexcept {
+        if (buffer) {
+            buffer->commit(n);
+        }
+    }
+
+    void consume(size_t n) noexcept {
+        if (buffer) {
+            buffer->consume(n);
+        }
+    }
+
+private:
+    static constexpr size_t MAX_SIZE = std::numeric_limits<std::ptrdiff_t>::max(); // as flat_buffer
+
+    BufferPool& pool;
+    BufferPool::Buffer buffer;
+};
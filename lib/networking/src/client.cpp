@@ -1,4 +1,5 @@
 #include "client.h"
+#include "deflateOption.h"
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
@@ -14,11 +15,20 @@
 
 class Client::ClientImpl {
 public:
-    ClientImpl(std::string_view address, std::string_view port)
+    ClientImpl(std::string_view address, std::string_view port, Compression compression, Protocol protocol)
         : isClosed{false},
         hostAddress{address.data(), address.size()},
         ioService{},
         websocket{ioService} {
+            websocket.set_option(deflateOption(compression, false));
+            if (protocol == Protocol::Binary) {
+                websocket.binary(true);
+                websocket.set_option(boost::beast::websocket::stream_base::decorator(
+                    [] (boost::beast::websocket::request_type& request) {
+                        request.set(boost::beast::http::field::sec_websocket_protocol,
+                                    boost::beast::string_view{BINARY_SUBPROTOCOL.data(), BINARY_SUBPROTOCOL.size()});
+                    }));
+            }
             boost::asio::ip::tcp::resolver resolver{ioService};
             connect(resolver.resolve(address, port));
     }
@@ -108,8 +118,8 @@ void Client::ClientImpl::reportError(std::string_view /*message*/) {
 /////////////////////////////////////////////////////////////////////////////
 
 
-Client::Client(std::string_view address, std::string_view port)
-    : impl{std::make_unique<ClientImpl>(address, port)}
+Client::Client(std::string_view address, std::string_view port, Compression compression, Protocol protocol)
+    : impl{std::make_unique<ClientImpl>(address, port, compression, protocol)}
 { }
 
 
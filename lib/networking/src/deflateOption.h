@@ -0,0 +1,22 @@
+#pragma once
+
+#include "compression.h"
+
+#include <boost/beast/websocket/option.hpp>
+
+/**
+ *  The Beast option enabling Compression on a websocket stream in the server or client role.
+ */
+inline boost::beast::websocket::permessage_deflate
+deflateOption(const Compression& compression, bool serverRole) {
+    boost::beast::websocket::permessage_deflate option;
+    option.server_enable = serverRole && compression.enabled;
+    option.client_enable = !serverRole && compression.enabled;
+    option.server_max_window_bits = compression.windowBits;
+    option.client_max_window_bits = compression.windowBits;
+    option.server_no_context_takeover = compression.noContextTakeover;
+    option.client_no_context_takeover = compression.noContextTakeover;
+    option.compLevel = compression.level;
+    option.memLevel = compression.memLevel;
+    return option;
+}
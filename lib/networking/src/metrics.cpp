@@ -0,0 +1,201 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr const char* TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+
+std::string
+formatNumber(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+
+// name{labels} or name{labels,extra}, without braces if both are empty
+std::string
+seriesName(const std::string& name, const std::string& labels, const std::string& extra = {}) {
+    if (labels.empty() && extra.empty()) {
+        return name;
+    }
+    std::string separator = !labels.empty() && !extra.empty() ? "," : "";
+    return name + "{" + labels + separator + extra + "}";
+}
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Histograms
+/////////////////////////////////////////////////////////////////////////////
+
+
+size_t
+Histogram::bucketOf(uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    unsigned topBit = 63 - __builtin_clzll(value);
+    if (MAX_BITS <= topBit) {
+        return NUM_BUCKETS - 1;
+    }
+    // the bits below the top bit select the sub-bucket within the power of two
+    unsigned shift = topBit - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+
+uint64_t
+Histogram::upperBound(size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    if (bucket == NUM_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    uint64_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t subBucket = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+
+uint64_t
+Histogram::count() const noexcept {
+    uint64_t samples = 0;
+    for (const auto& bucket : buckets) {
+        samples += bucket.load(std::memory_order_relaxed);
+    }
+    return samples;
+}
+
+
+uint64_t
+Histogram::quantile(double quantile) const noexcept {
+    uint64_t samples = count();
+    if (samples == 0) {
+        return 0;
+    }
+    // the rank of the sample at quantile, counting from 1
+    auto rank = static_cast<uint64_t>(std::ceil(quantile * samples));
+    rank = std::clamp<uint64_t>(rank, 1, samples);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+        seen += bucketCount(bucket);
+        if (rank <= seen) {
+            return upperBound(bucket);
+        }
+    }
+    // samples recorded while counting
+    return upperBound(NUM_BUCKETS - 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Registry
+/////////////////////////////////////////////////////////////////////////////
+
+
+Counter&
+Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock{mutex};
+    return *series(name, help, labels, Type::Counter, 1).counter;
+}
+
+
+Gauge&
+Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock{mutex};
+    return *series(name, help, labels, Type::Gauge, 1).gauge;
+}
+
+
+Histogram&
+Metrics::histogram(const std::string& name, const std::string& help, double unit, const std::string& labels) {
+    std::lock_guard<std::mutex> lock{mutex};
+    return *series(name, help, labels, Type::Histogram, unit).histogram;
+}
+
+
+Metrics::Series&
+Metrics::series(const std::string& name, const std::string& help, const std::string& labels,
+                Type type, double unit) {
+    auto [family, inserted] = families.try_emplace(name, Family{type, help, unit, {}});
+    if (family->second.type != type) {
+        throw std::logic_error{"metric " + name + " was registered as a " + TYPE_NAMES[static_cast<size_t>(family->second.type)]};
+    }
+    for (auto& series : family->second.series) {
+        if (series.labels == labels) {
+            return series;
+        }
+    }
+
+    Series series{labels};
+    switch (type) {
+        case Type::Counter: series.counter = std::make_unique<Counter>(); break;
+        case Type::Gauge: series.gauge = std::make_unique<Gauge>(); break;
+        case Type::Histogram: series.histogram = std::make_unique<Histogram>(); break;
+    }
+    return family->second.series.emplace_back(std::move(series));
+}
+
+
+std::string
+Metrics::exposition() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    std::string text;
+    for (const auto& [name, family] : families) {
+        text += "# HELP " + name + " " + family.help + "\n";
+        text += "# TYPE " + name + " " + TYPE_NAMES[static_cast<size_t>(family.type)] + "\n";
+
+        for (const auto& series : family.series) {
+            if (series.counter) {
+                text += seriesName(name, series.labels) + " " + std::to_string(series.counter->value()) + "\n";
+            } else if (series.gauge) {
+                text += seriesName(name, series.labels) + " " + std::to_string(series.gauge->value()) + "\n";
+            } else {
+                // the counts are read once, so the buckets, +Inf and _count agree
+                const Histogram& histogram = *series.histogram;
+                std::array<uint64_t, Histogram::NUM_BUCKETS> counts;
+                size_t last = 0;
+                for (size_t bucket = 0; bucket < Histogram::NUM_BUCKETS; bucket++) {
+                    counts[bucket] = histogram.bucketCount(bucket);
+                    if (counts[bucket] != 0) {
+                        last = bucket;
+                    }
+                }
+
+                uint64_t cumulative = 0;
+                for (size_t bucket = 0; bucket < Histogram::NUM_BUCKETS - 1; bucket++) {
+                    cumulative += counts[bucket];
+                    bool endsPowerOfTwo = bucket % Histogram::SUB_BUCKETS == Histogram::SUB_BUCKETS - 1;
+                    if (endsPowerOfTwo) {
+                        auto bound = formatNumber(Histogram::upperBound(bucket) * family.unit);
+                        text += seriesName(name + "_bucket", series.labels, "le=\"" + bound + "\"")
+                            + " " + std::to_string(cumulative) + "\n";
+                    }
+                    if (endsPowerOfTwo && last <= bucket) {
+                        break;
+                    }
+                }
+                uint64_t samples = 0;
+                for (auto count : counts) {
+                    samples += count;
+                }
+                text += seriesName(name + "_bucket", series.labels, "le=\"+Inf\"")
+                    + " " + std::to_string(samples) + "\n";
+                text += seriesName(name + "_sum", series.labels)
+                    + " " + formatNumber(histogram.sum() * family.unit) + "\n";
+                text += seriesName(name + "_count", series.labels) + " " + std::to_string(samples) + "\n";
+            }
+        }
+    }
+    return text;
+}
@@ -1,7 +1,20 @@
 #include "server.h"
+#include "userTable.h"
+#include "bufferPool.h"
+#include "deflateOption.h"
+#include "timerWheel.h"
 
+#include "mpscQueue.h"
+#include "spscQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
-#include <unordered_map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
@@ -14,33 +27,229 @@ using namespace std::string_literals;
 
 
 class Channel;
+class HTTPSession;
+class IOWorker;
+
+constexpr size_t QUEUE_CAPACITY = 8192;
+constexpr auto QUEUE_RETRY_INTERVAL = std::chrono::milliseconds(1);
+constexpr size_t PRIORITY_CLASSES = static_cast<size_t>(Priority::Chat) + 1;
+constexpr unsigned KEEPALIVE_TICKS_PER_TIMEOUT = 8; // resolution of the keepalive timer wheels
+constexpr auto ACCEPT_RETRY_INTERVAL = std::chrono::milliseconds(50);
+constexpr size_t FREE_SESSIONS_PER_WORKER = 256;
+constexpr std::string_view METRICS_TARGET = "/metrics";
+
+/**
+ *  The write queue of a Channel, updated by the IOWorker serving it and read by the
+ *  thread using the Server (see Server::queuedWrites()).
+ */
+struct WriteGauge {
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> messages{0};
+};
 
+/**
+ *  A Channel connecting or disconnecting, reported by the IOWorker serving it.
+ */
+struct ConnectionEvent {
+    User user;
+    size_t worker;
+    bool connected;
+    std::shared_ptr<const WriteGauge> writes{};
+};
 
-class ServerImpl {
+/**
+ *  Work for an IOWorker, either text to send to user or a request to disconnect user.
+ *  The text is either owned (text) or shared with other users (payload).
+ */
+struct Outbound {
+    User user;
+    std::string text;
+    Payload payload{};
+    bool disconnect = false;
+    Priority priority = Priority::Informational;
+    Payload event{};
+};
+
+
+/**
+ *  Hands out dense User ids (see User). Channels take an id when they are created on
+ *  an I/O thread. The id is released by whichever side lets go of the user last: the
+ *  thread using the Server once it processed the disconnection reported by a worker,
+ *  or the worker once it closed a channel for Server::disconnect().
+ */
+class UserIdAllocator {
 public:
-    ServerImpl(Server& server, unsigned short port, std::string httpMessage)
-        : server{server},
-        endpoint{boost::asio::ip::tcp::v4(), port},
-        ioContext{},
-        acceptor{ioContext, endpoint},
-        httpMessage{std::move(httpMessage)} {
-        listenForConnections();
+    User allocate() {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (freeSlots.empty()) {
+            generations.push_back(0);
+            return User::fromSlot(generations.size() - 1, 0);
+        }
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return User::fromSlot(slot, generations[slot]);
     }
 
-    void listenForConnections();
-    void registerChannel(Channel& channel);
+    void release(User user) {
+        std::lock_guard<std::mutex> lock{mutex};
+        uint32_t slot = user.slot();
+        if (slot < generations.size() && generations[slot] == user.generation()) {
+            generations[slot]++;
+            freeSlots.push_back(slot);
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<uint32_t> generations{0}; // slot 0 is never handed out, User{0} is not a client
+    std::vector<uint32_t> freeSlots;
+};
+
+
+class ServerImpl {
+public:
+    ServerImpl(Server& server, unsigned short port, AssetBundle assets, const ServerOptions& options);
+    ~ServerImpl();
+
+    boost::asio::ip::tcp::acceptor openAcceptor(boost::asio::io_context& ioContext, bool reusePort);
+
+    /**
+     *  Keeps one more accept outstanding on the given acceptor. Called once per
+     *  Listening::pendingAccepts, every accept rearms itself when it completes.
+     */
+    void listenForConnections(size_t acceptor);
     void reportError(std::string_view message);
 
-    using ChannelMap = std::unordered_map<User, std::shared_ptr<Channel>, UserHash>;
+    /**
+     *  Runs the connection callbacks for the events reported by the IOWorkers.
+     *  Called on the thread using the Server.
+     */
+    void processConnectionEvents();
 
     Server& server;
     const boost::asio::ip::tcp::endpoint endpoint;
+    // the bundle outlives the sessions, responses refer to it rather than copying it
+    const AssetBundle assets;
+    const Compression compression;
+    const Backpressure backpressure;
+    const Keepalive keepalive;
+    const Listening listening;
+    const RateLimit rateLimit;
+
+    // Channels are spread over the workers. Without I/O threads there is a single worker
+    // whose io_context is polled by Server::update(), so everything stays on one thread.
+    bool threaded;
+    std::vector<std::unique_ptr<IOWorker>> workers;
+
+    // Either one acceptor per worker, running on that worker, or a single acceptor on the
+    // first worker that hands the connections to the workers round robin.
+    std::vector<boost::asio::ip::tcp::acceptor> acceptors;
+    size_t nextWorker = 0;
+
+    // served at /metrics, updated by the workers
+    Metrics metrics;
+    Gauge& openConnections;
+    Counter& acceptedConnections;
+    Counter& failedAccepts;
+    Counter& messagesReceived;
+    Counter& bytesReceived;
+    Counter& messagesSent;
+    Counter& bytesSent;
+    Counter& droppedChat;
+    Counter& congestionEvictions;
+    Counter& idleEvictions;
+    Counter& rateLimitedMessages;
+    Counter& rateLimitDisconnects;
+
+    // written by every worker, read by the thread using the Server
+    MPSCQueue<Message> incoming{QUEUE_CAPACITY};
+    MPSCQueue<ConnectionEvent> connectionEvents{QUEUE_CAPACITY};
+
+    UserIdAllocator userIds;
+
+    // the worker serving each connected user, only used by the thread using the Server
+    struct ConnectedUser {
+        size_t worker;
+        std::shared_ptr<const WriteGauge> writes;
+    };
+    UserTable<ConnectedUser> users;
+};
+
+
+/**
+ *  An io_context with the Channels it serves. All Channel state is only touched by the
+ *  thread running the io_context, the thread using the Server reaches it through the
+ *  outbound queue.
+ */
+class IOWorker {
+public:
+    using ChannelMap = UserTable<std::shared_ptr<Channel>>;
+
+    IOWorker(ServerImpl& serverImpl, size_t index);
+
+    void start();
+    void stop();
+
+    // I/O THREAD
+    void registerChannel(Channel& channel);
+    void channelClosed(User user);
+    void drainOutbound();
+
+    /**
+     *  Hands an item of the outbound queue to its channel.
+     */
+    void deliverOutbound(Outbound item);
+
+    /**
+     *  Serves an accepted connection with an HTTPSession from the pool of this worker.
+     */
+    void startSession(boost::asio::ip::tcp::socket socket);
+
+    /**
+     *  The current tick of the keepalive timer wheel, channels record their last
+     *  activity in these ticks.
+     */
+    [[nodiscard]] uint64_t keepaliveTick() const noexcept { return keepaliveWheel.now(); }
+
+    // THREAD USING THE SERVER
+    void post(Outbound outbound);
+    void flushOutbound();
+
+    ServerImpl& serverImpl;
+    const size_t index;
+    // Lent to the channels and connections of this worker. The pools outlive the io_context
+    // so channels and sessions still held by pending handlers can give their memory back.
+    BufferPool readBuffers;
+    std::vector<std::unique_ptr<HTTPSession>> freeSessions;
     boost::asio::io_context ioContext;
-    boost::asio::ip::tcp::acceptor acceptor;
-    boost::beast::http::string_body::value_type httpMessage;
+
+private:
+    void reportConnectionEvent(ConnectionEvent event);
+    void flushConnectionEvents();
 
     ChannelMap channels;
-    std::deque<Message> incoming;
+    std::deque<ConnectionEvent> unsentEvents;
+    boost::asio::steady_timer retryTimer;
+    bool retryPending = false;
+
+    SPSCQueue<Outbound> outbound{QUEUE_CAPACITY};
+    std::deque<Outbound> unsentOutbound;
+    std::atomic<bool> drainScheduled{false};
+
+    void recycleSession(HTTPSession* session);
+
+    // KEEPALIVE (see Keepalive), every channel is scheduled on the wheel until it closes
+    void turnKeepaliveWheel();
+    void checkIdle(User user);
+
+    bool keepaliveEnabled;
+    std::chrono::milliseconds keepaliveTickInterval;
+    uint64_t pingTicks;
+    uint64_t idleTicks;
+    TimerWheel keepaliveWheel;
+    boost::asio::steady_timer keepaliveTimer;
+
+    std::thread thread;
 };
 
 
@@ -51,46 +260,216 @@ public:
 
 class Channel : public std::enable_shared_from_this<Channel> {
 public:
-    Channel(boost::asio::ip::tcp::socket socket, ServerImpl& serverImpl)
+    Channel(boost::asio::ip::tcp::socket socket, IOWorker& worker)
         : disconnected{false},
-        user{reinterpret_cast<uintptr_t>(this)},
-        serverImpl{serverImpl},
-        streamBuf{},
+        user{worker.serverImpl.userIds.allocate()},
+        worker{worker},
+        streamBuf{worker.readBuffers},
         websocket{std::move(socket)},
-        readBuffer{serverImpl.incoming}
+        retryTimer{websocket.get_executor()},
+        evictionTimer{websocket.get_executor()},
+        writeGauge{std::make_shared<WriteGauge>()},
+        tokens{worker.serverImpl.rateLimit.burst},
+        refilledAt{std::chrono::steady_clock::now()}
     { }
 
     void start(boost::beast::http::request<boost::beast::http::string_body>& request);
-    void send(std::string outgoing);
+
+    /**
+     *  Sends the text or payload of the item, or its event if the peer speaks the binary protocol.
+     */
+    void send(Outbound item);
     void disconnect();
 
+    /**
+     *  Closes the socket outright and reports the channel as closed, for peers that
+     *  stopped reading or vanished. A close frame would never be answered.
+     */
+    void evict();
+
+    /**
+     *  Pings the peer once it was silent for pingTicks and evicts it once it was silent
+     *  for idleTicks. Returns the tick to check the channel again, 0 if it was evicted.
+     */
+    uint64_t checkIdle(uint64_t now, uint64_t pingTicks, uint64_t idleTicks);
+
     [[nodiscard]] User getConnection() const noexcept { return user; }
+    [[nodiscard]] std::shared_ptr<const WriteGauge> getWriteGauge() const noexcept { return writeGauge; }
 
 private:
+    void send(std::string outgoing, Priority priority);
+    void send(Payload outgoing, Priority priority);
     void readMessage();
+
+    /**
+     *  Reads the rest of a message, firstSize is the number of bytes readMessage() read
+     *  into firstByte, 0 if the first frame of the message was empty.
+     */
+    void readPayload(std::size_t firstSize);
+    void received(std::string message);
+
+    // RATE LIMITING (see RateLimit)
+
+    /**
+     *  Takes a token for a message that started to arrive. Returns false if the bucket
+     *  is empty, the message is then to be dropped.
+     */
+    bool admitMessage();
+
+    /**
+     *  Takes a token for every frame of a message of the binary protocol after the first,
+     *  which admitMessage() took a token for. The frames that find the bucket empty are
+     *  cut off the message, returns how many were.
+     */
+    unsigned admitFrames(std::string& message);
+
+    /**
+     *  Refills the bucket and takes a token from it, returns false if it is empty.
+     */
+    bool takeToken();
+
+    /**
+     *  Evicts the channel if it dropped maxDroppedInARow messages or frames since the
+     *  last message that was received whole. Returns true if it did.
+     */
+    bool evictIfFlooding();
+
+    /**
+     *  Reads the rest of a dropped message without queuing it, or evicts the channel if
+     *  it dropped too many messages in a row.
+     */
+    void dropMessage();
+    void deliver(Message message);
+    void close();
     void afterWrite(std::error_code errorCode, std::size_t size);
+    void write();
+
+    /**
+     *  Text waiting to be written, either owned by the channel or a Payload shared
+     *  with other channels.
+     */
+    struct PendingWrite {
+        std::string text;
+        Payload payload;
+        Priority priority;
+
+        boost::asio::const_buffer buffer() const {
+            return payload ? boost::asio::buffer(*payload) : boost::asio::buffer(text);
+        }
+        size_t size() const {
+            return payload ? payload->size() : text.size();
+        }
+    };
+
+    /**
+     *  Queues a write behind the one in flight.
+     */
+    void queueWrite(PendingWrite pending);
+
+    /**
+     *  Moves the next queued write, by priority, to writing. Returns false if none is queued.
+     */
+    bool takeNextWrite();
+
+    // BACKPRESSURE (see Backpressure)
+
+    /**
+     *  Queues the write, or drops it if it is chat and the channel is congested.
+     */
+    void enqueue(PendingWrite pending);
+    void startCongestion();
+    void endCongestion();
+    void updateWriteGauge();
 
     bool disconnected;
     User user;
-    ServerImpl &serverImpl;
+    IOWorker &worker;
+    Protocol protocol = Protocol::Text;
 
-    boost::beast::flat_buffer streamBuf;
+    char firstByte = 0; // read before streamBuf is borrowed, see readMessage()
+    PooledReadBuffer streamBuf;
     boost::beast::websocket::stream<boost::asio::ip::tcp::socket> websocket;
-
-    std::deque<Message> &readBuffer;
-    std::deque<std::string> writeBuffer;
+    boost::asio::steady_timer retryTimer;
+
+    // One queue per Priority, the highest class with writes queued is written first. The
+    // queues are only allocated while writes wait behind the one in flight.
+    using WriteQueues = std::array<std::deque<PendingWrite>, PRIORITY_CLASSES>;
+    std::unique_ptr<WriteQueues> writeQueues;
+    PendingWrite writing; // left untouched while it is written, so its buffer stays valid
+    bool writeInFlight = false;
+    size_t queuedMessages = 0; // including the one being written
+    size_t queuedBytes = 0;
+    bool congested = false;
+    size_t droppedWrites = 0; // chat writes dropped during the current congestion
+    boost::asio::steady_timer evictionTimer;
+    std::shared_ptr<WriteGauge> writeGauge;
+
+    uint64_t lastActivity = 0; // keepalive tick of the last frame received
+    bool pinged = false;       // a ping was sent since then
+
+    double tokens;
+    std::chrono::steady_clock::time_point refilledAt;
+    unsigned droppedInARow = 0; // messages and frames dropped since a message was received whole
 };
 
 
+// true if the Sec-WebSocket-Protocol header of the upgrade request offers the subprotocol
+static bool offersSubprotocol(boost::beast::string_view offered, std::string_view subprotocol) {
+    while (!offered.empty()) {
+        auto comma = std::min(offered.find(','), offered.size());
+        auto candidate = offered.substr(0, comma);
+        while (!candidate.empty() && candidate.front() == ' ') {
+            candidate.remove_prefix(1);
+        }
+        while (!candidate.empty() && candidate.back() == ' ') {
+            candidate.remove_suffix(1);
+        }
+        if (std::string_view{candidate.data(), candidate.size()} == subprotocol) {
+            return true;
+        }
+        offered.remove_prefix(std::min(comma + 1, offered.size()));
+    }
+    return false;
+}
+
+
+// wraps text for a Client of the binary protocol
+static std::string textFrame(std::string_view text) {
+    std::string frame;
+    frame.reserve(text.size() + 5);
+    FrameWriter writer{frame, Opcode::Text};
+    writer.rest(text);
+    writer.finish();
+    return frame;
+}
+
+
 void Channel::start(boost::beast::http::request<boost::beast::http::string_body>& request) {
     auto self = shared_from_this();
+    websocket.set_option(deflateOption(worker.serverImpl.compression, true));
+    if (offersSubprotocol(request[boost::beast::http::field::sec_websocket_protocol], BINARY_SUBPROTOCOL)) {
+        protocol = Protocol::Binary;
+        websocket.binary(true);
+        websocket.set_option(boost::beast::websocket::stream_base::decorator(
+            [] (boost::beast::websocket::response_type& response) {
+                response.set(boost::beast::http::field::sec_websocket_protocol,
+                             boost::beast::string_view{BINARY_SUBPROTOCOL.data(), BINARY_SUBPROTOCOL.size()});
+            }));
+    }
+    // pongs answering our pings are only seen here, they count as activity
+    websocket.control_callback([this] (auto /*kind*/, auto /*payload*/) {
+        lastActivity = worker.keepaliveTick();
+        pinged = false;
+    });
     websocket.async_accept(request,
         [this, self] (std::error_code errorCode) {
             if (!errorCode) {
-                serverImpl.registerChannel(*this);
+                lastActivity = worker.keepaliveTick();
+                worker.registerChannel(*this);
                 self->readMessage();
             } else {
-                serverImpl.server.disconnect(user);
+                // the user was never reported, nobody else holds its id
+                worker.serverImpl.userIds.release(user);
             }
         }
     );
@@ -99,25 +478,110 @@ void Channel::start(boost::beast::http::request<boost::beast::http::string_body>
 
 void Channel::disconnect() {
     disconnected = true;
-    boost::beast::error_code ec;
-    websocket.close(boost::beast::websocket::close_reason{}, ec);
+    if (!writeInFlight) {
+        close();
+    }
+    // otherwise afterWrite() closes once the pending writes are done
+}
+
+
+void Channel::close() {
+    // closing asynchronously, a blocking close would stall every channel of the worker
+    // until this client answers the close frame
+    websocket.async_close(boost::beast::websocket::close_reason{},
+        [self = shared_from_this()] (auto /*errorCode*/) {
+            // Swallow errors while closing.
+        }
+    );
+}
+
+
+void Channel::send(Outbound item) {
+    if (protocol == Protocol::Text) {
+        if (item.payload) {
+            send(std::move(item.payload), item.priority);
+        } else {
+            send(std::move(item.text), item.priority);
+        }
+    } else if (item.event) {
+        send(std::move(item.event), item.priority);
+    } else {
+        send(textFrame(item.payload ? std::string_view{*item.payload} : std::string_view{item.text}),
+             item.priority);
+    }
 }
 
 
-void Channel::send(std::string outgoing) {
-    if (outgoing.empty()) {
+void Channel::send(std::string outgoing, Priority priority) {
+    if (outgoing.empty() || disconnected) {
         return;
     }
-    writeBuffer.push_back(std::move(outgoing));
+    enqueue({std::move(outgoing), nullptr, priority});
+}
+
 
-    if (1 < writeBuffer.size()) {
-        // Note, multiple writes will be chained within asio via `continueSending`,
-        // so that callback should be used instead of directly invoking async_write
-        // again.
+void Channel::send(Payload outgoing, Priority priority) {
+    if (!outgoing || outgoing->empty() || disconnected) {
         return;
     }
+    enqueue({{}, std::move(outgoing), priority});
+}
+
+
+void Channel::enqueue(PendingWrite pending) {
+    if (pending.priority == Priority::Chat && congested) {
+        droppedWrites++;
+        worker.serverImpl.droppedChat.add();
+        return;
+    }
+
+    queuedBytes += pending.size();
+    queuedMessages++;
+    // Note, while a write is in flight further writes are chained by afterWrite(),
+    // async_write must not be invoked again until it completes.
+    if (writeInFlight) {
+        queueWrite(std::move(pending));
+    } else {
+        writing = std::move(pending);
+        write();
+    }
+
+    const Backpressure& limits = worker.serverImpl.backpressure;
+    if (!congested && (limits.highWatermarkBytes < queuedBytes
+                       || limits.highWatermarkMessages < queuedMessages)) {
+        startCongestion();
+    }
+    updateWriteGauge();
+}
+
+
+void Channel::queueWrite(PendingWrite pending) {
+    if (!writeQueues) {
+        writeQueues = std::make_unique<WriteQueues>();
+    }
+    (*writeQueues)[static_cast<size_t>(pending.priority)].push_back(std::move(pending));
+}
+
+
+bool Channel::takeNextWrite() {
+    if (!writeQueues) {
+        return false;
+    }
+    auto queue = std::find_if(writeQueues->begin(), writeQueues->end(),
+        [] (const auto& queue) { return !queue.empty(); });
+    if (queue == writeQueues->end()) {
+        writeQueues.reset();
+        return false;
+    }
+    writing = std::move(queue->front());
+    queue->pop_front();
+    return true;
+}
 
-    websocket.async_write(boost::asio::buffer(writeBuffer.front()),
+
+void Channel::write() {
+    writeInFlight = true;
+    websocket.async_write(writing.buffer(),
         [this, self = shared_from_this()] (auto errorCode, std::size_t size) {
             afterWrite(errorCode, size);
         }
@@ -128,35 +592,279 @@ void Channel::send(std::string outgoing) {
 void Channel::afterWrite(std::error_code errorCode, std::size_t size) {
     if (errorCode) {
         if (!disconnected) {
-            serverImpl.server.disconnect(user);
+            worker.channelClosed(user);
         }
         return;
     }
 
-    writeBuffer.pop_front();
+    worker.serverImpl.messagesSent.add();
+    worker.serverImpl.bytesSent.add(size);
+
+    writeInFlight = false;
+    queuedBytes -= writing.size();
+    queuedMessages--;
+    writing = {};
+
+    const Backpressure& limits = worker.serverImpl.backpressure;
+    if (congested && queuedBytes <= limits.lowWatermarkBytes
+                  && queuedMessages <= limits.lowWatermarkMessages) {
+        endCongestion();
+    }
+    updateWriteGauge();
 
     // Continue asynchronously processing any further messages that have been sent
-    if (!writeBuffer.empty()) {
-        websocket.async_write(boost::asio::buffer(writeBuffer.front()),
-            [this, self = shared_from_this()] (auto errorCode, std::size_t size) {
-                afterWrite(errorCode, size);
-            }
-        );
+    if (takeNextWrite()) {
+        write();
+    } else if (disconnected) {
+        close();
     }
 }
 
 
+void Channel::startCongestion() {
+    congested = true;
+
+    // shed the chat that is still queued, a chat write in flight is left to complete
+    if (writeQueues) {
+        auto& chat = (*writeQueues)[static_cast<size_t>(Priority::Chat)];
+        for (const auto& pending : chat) {
+            queuedBytes -= pending.size();
+        }
+        queuedMessages -= chat.size();
+        droppedWrites += chat.size();
+        worker.serverImpl.droppedChat.add(chat.size());
+        chat.clear();
+    }
+
+    evictionTimer.expires_after(worker.serverImpl.backpressure.gracePeriod);
+    evictionTimer.async_wait([this, self = shared_from_this()] (auto errorCode) {
+        if (!errorCode && congested && !disconnected) {
+            worker.serverImpl.congestionEvictions.add();
+            evict();
+        }
+    });
+}
+
+
+void Channel::endCongestion() {
+    congested = false;
+    evictionTimer.cancel();
+
+    if (0 < droppedWrites && !disconnected) {
+        std::string notice = "(" + std::to_string(droppedWrites)
+            + " chat messages were dropped while the connection caught up)\n";
+        if (protocol == Protocol::Binary) {
+            notice = textFrame(notice);
+        }
+        droppedWrites = 0;
+        queuedBytes += notice.size();
+        queuedMessages++;
+        queueWrite({std::move(notice), nullptr, Priority::Informational});
+    }
+}
+
+
+void Channel::evict() {
+    // closing the socket fails the pending read and write
+    worker.channelClosed(user);
+    boost::system::error_code ignored;
+    websocket.next_layer().close(ignored);
+}
+
+
+uint64_t Channel::checkIdle(uint64_t now, uint64_t pingTicks, uint64_t idleTicks) {
+    uint64_t idle = now - lastActivity;
+    if (idleTicks <= idle) {
+        worker.serverImpl.idleEvictions.add();
+        evict();
+        return 0;
+    }
+    if (idle < pingTicks) {
+        return lastActivity + pingTicks;
+    }
+    if (!pinged && !disconnected) {
+        pinged = true;
+        websocket.async_ping({}, [self = shared_from_this()] (auto /*errorCode*/) {
+            // a failed ping shows up as a failed read
+        });
+    }
+    return lastActivity + idleTicks;
+}
+
+
+void Channel::updateWriteGauge() {
+    writeGauge->bytes.store(queuedBytes, std::memory_order_relaxed);
+    writeGauge->messages.store(queuedMessages, std::memory_order_relaxed);
+}
+
+
 void Channel::readMessage() {
+    // Reading the first byte of the next message into the channel itself, so the channel
+    // holds no read buffer while it waits. Control frames are answered along the way.
     auto self = shared_from_this();
-    websocket.async_read(streamBuf,
+    websocket.async_read_some(boost::asio::buffer(&firstByte, 1),
         [this, self] (auto errorCode, std::size_t size) {
+            if (errorCode) {
+                if (!disconnected) {
+                    worker.channelClosed(user);
+                }
+            } else if (!admitMessage()) {
+                dropMessage();
+            } else if (!websocket.is_message_done()) {
+                readPayload(size);
+            } else if (0 < size) {
+                received(std::string(1, firstByte));
+            } else {
+                readMessage(); // the message was empty
+            }
+        }
+    );
+}
+
+
+void Channel::readPayload(std::size_t firstSize) {
+    auto self = shared_from_this();
+    websocket.async_read(streamBuf,
+        [this, self, firstSize] (auto errorCode, std::size_t /*size*/) {
+            if (!errorCode) {
+                auto payload = streamBuf.data();
+                std::string message;
+                message.reserve(firstSize + payload.size());
+                message.append(&firstByte, firstSize);
+                message.append(static_cast<const char*>(payload.data()), payload.size());
+                streamBuf.release();
+                received(std::move(message));
+            } else if (!disconnected) {
+                worker.channelClosed(user);
+            }
+        }
+    );
+}
+
+
+bool Channel::admitMessage() {
+    if (takeToken()) {
+        return true;
+    }
+    droppedInARow++;
+    worker.serverImpl.rateLimitedMessages.add();
+    return false;
+}
+
+
+bool Channel::takeToken() {
+    const RateLimit& limit = worker.serverImpl.rateLimit;
+    if (limit.messagesPerSecond <= 0) {
+        return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - refilledAt;
+    refilledAt = now;
+    tokens = std::min(limit.burst, tokens + elapsed.count() * limit.messagesPerSecond);
+    if (1 <= tokens) {
+        tokens -= 1;
+        return true;
+    }
+    return false;
+}
+
+
+unsigned Channel::admitFrames(std::string& message) {
+    std::string_view frames = message;
+    Opcode opcode;
+    std::string_view fields;
+    std::size_t admitted = message.size();
+    unsigned rejected = 0;
+    // trailing bytes that do not form a whole frame take a token too, they are
+    // handed on as a frame of their own
+    for (bool more = nextFrame(frames, opcode, fields); more && !frames.empty();
+            more = nextFrame(frames, opcode, fields)) {
+        if (rejected == 0 && takeToken()) {
+            continue;
+        }
+        if (rejected == 0) {
+            admitted = message.size() - frames.size();
+        }
+        rejected++;
+    }
+    message.resize(admitted);
+    return rejected;
+}
+
+
+bool Channel::evictIfFlooding() {
+    unsigned maxDropped = worker.serverImpl.rateLimit.maxDroppedInARow;
+    if (0 < maxDropped && maxDropped <= droppedInARow) {
+        worker.serverImpl.rateLimitDisconnects.add();
+        if (!disconnected) {
+            evict();
+        }
+        return true;
+    }
+    return false;
+}
+
+
+void Channel::dropMessage() {
+    // dropped messages still show the peer is alive
+    lastActivity = worker.keepaliveTick();
+    pinged = false;
+
+    if (evictIfFlooding()) {
+        return;
+    }
+    if (websocket.is_message_done()) {
+        readMessage();
+        return;
+    }
+
+    auto self = shared_from_this();
+    websocket.async_read(streamBuf,
+        [this, self] (auto errorCode, std::size_t /*size*/) {
+            streamBuf.release();
             if (!errorCode) {
-                auto message = boost::beast::buffers_to_string(streamBuf.data());
-                readBuffer.push_back({user, std::move(message)});
-                streamBuf.consume(streamBuf.size());
-                this->readMessage();
+                readMessage();
             } else if (!disconnected) {
-                serverImpl.server.disconnect(user);
+                worker.channelClosed(user);
+            }
+        }
+    );
+}
+
+
+void Channel::received(std::string message) {
+    unsigned rejected = protocol == Protocol::Binary ? admitFrames(message) : 0;
+    if (rejected == 0) {
+        droppedInARow = 0;
+    } else {
+        droppedInARow += rejected;
+        worker.serverImpl.rateLimitedMessages.add(rejected);
+        if (evictIfFlooding()) {
+            return;
+        }
+    }
+    worker.serverImpl.messagesReceived.add();
+    worker.serverImpl.bytesReceived.add(message.size());
+    lastActivity = worker.keepaliveTick();
+    pinged = false;
+    deliver({user, std::move(message), nullptr, Priority::Informational, nullptr, protocol});
+}
+
+
+void Channel::deliver(Message message) {
+    if (worker.serverImpl.incoming.push(std::move(message))) {
+        readMessage();
+        return;
+    }
+
+    // The inbox is full. Stop reading from this channel until the game logic catches up,
+    // which pushes back on the client through TCP flow control.
+    retryTimer.expires_after(QUEUE_RETRY_INTERVAL);
+    retryTimer.async_wait(
+        [this, self = shared_from_this(), message = std::move(message)] (auto errorCode) mutable {
+            if (!errorCode && !disconnected) {
+                deliver(std::move(message));
             }
         }
     );
@@ -168,36 +876,66 @@ void Channel::readMessage() {
 ////////////////////////////////////////////////////////////////////////////////
 
 
+/**
+ *  Serves the HTTP requests of a connection until it is upgraded to a websocket Channel.
+ *  Sessions are pooled by their IOWorker (see IOWorker::startSession), a session in the
+ *  pool holds no socket but keeps its read buffer for the next connection.
+ */
 class HTTPSession : public std::enable_shared_from_this<HTTPSession> {
 public:
-    HTTPSession(ServerImpl& serverImpl)
-        : serverImpl{serverImpl},
-        socket{serverImpl.ioContext},
+    HTTPSession(IOWorker& worker)
+        : worker{worker},
+        serverImpl{worker.serverImpl},
         streamBuf{}
     { }
 
-    void start();
+    void start(boost::asio::ip::tcp::socket socket);
     void handleRequest();
 
-    boost::asio::ip::tcp::socket & getSocket() { return socket; }
+    /**
+     *  Closes the connection and forgets the request, so the session can be pooled.
+     */
+    void clear();
 
 private:
+    void readRequest();
+
+    /**
+     *  Responds with the metrics of the Server, in the Prometheus text format.
+     */
+    template <typename Send>
+    void serveMetrics(Send& send);
+
+    IOWorker &worker;
     ServerImpl &serverImpl;
-    boost::asio::ip::tcp::socket socket;
+    std::optional<boost::asio::ip::tcp::socket> socket;
     boost::beast::flat_buffer streamBuf;
     boost::beast::http::request<boost::beast::http::string_body> request;
 };
 
 
-void HTTPSession::start() {
-    boost::beast::http::async_read(socket, streamBuf, request,
+void HTTPSession::start(boost::asio::ip::tcp::socket socket) {
+    this->socket.emplace(std::move(socket));
+    readRequest();
+}
+
+
+void HTTPSession::clear() {
+    socket.reset();
+    streamBuf.clear();
+    request = {};
+}
+
+
+void HTTPSession::readRequest() {
+    boost::beast::http::async_read(*socket, streamBuf, request,
         [this, session = this->shared_from_this()]
         (std::error_code ec, std::size_t /*bytes*/) {
             if (ec) {
                 serverImpl.reportError("Error reading from HTTP stream.");
 
             } else if (boost::beast::websocket::is_upgrade(request)) {
-                auto channel = std::make_shared<Channel>(std::move(socket), serverImpl);
+                auto channel = std::make_shared<Channel>(std::move(*socket), worker);
                 channel->start(request);
 
             } else {
@@ -208,35 +946,41 @@ void HTTPSession::start() {
 }
 
 
+// Beast uses the Boost string_view
+static std::string_view toStringView(boost::beast::string_view view) {
+    return {view.data(), view.size()};
+}
+
+
 void HTTPSession::handleRequest() {
     auto send = [this, session = this->shared_from_this()] (auto&& response) {
         using Response = typename std::decay<decltype(response)>::type;
         auto sharedResponse =
         std::make_shared<Response>(std::forward<decltype(response)>(response));
 
-        boost::beast::http::async_write(socket, *sharedResponse,
+        boost::beast::http::async_write(*socket, *sharedResponse,
             [this, session, sharedResponse] (std::error_code ec, std::size_t /*bytes*/) {
                 if (ec) {
                     session->serverImpl.reportError("Error writing to HTTP stream");
-                    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+                    socket->shutdown(boost::asio::ip::tcp::socket::shutdown_send);
                 } else if (sharedResponse->need_eof()) {
                     // This signifies a deliberate close
                     boost::system::error_code ec;
-                    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
+                    socket->shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
                 if (ec) {
                     session->serverImpl.reportError("Error closing HTTP stream");
                 }
                 } else {
-                    session->start();
+                    session->readRequest();
                 }
             }
         );
     };
 
-    auto const badRequest =
-        [&request = this->request] (boost::beast::string_view why) {
+    auto const errorResponse =
+        [&request = this->request] (boost::beast::http::status status, boost::beast::string_view why) {
             boost::beast::http::response<boost::beast::http::string_body> result {
-            boost::beast::http::status::bad_request,
+            status,
             request.version()
         };
         result.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
@@ -250,48 +994,97 @@ void HTTPSession::handleRequest() {
     if (auto method = request.method();
         method != boost::beast::http::verb::get
         && method != boost::beast::http::verb::head) {
-            send(badRequest("Unknown HTTP-method"));
+            send(errorResponse(boost::beast::http::status::bad_request, "Unknown HTTP-method"));
+            return;
     }
 
-    // We only support index.html and /.
-    auto shouldServeIndex = [] (auto target) {
-        std::string const index = "/index.html"s;
-        constexpr auto npos = boost::beast::string_view::npos;
-        // NOTE: in C++20, we can use `ends_with` here instead.
-        return target == "/"
-            || (index.size() <= target.size()
-            && target.compare(target.size() - index.size(), npos, index) == 0);
-    };
-    if (!shouldServeIndex(request.target())) {
-        send(badRequest("Illegal request-target"));
+    auto target = toStringView(request.target());
+    if (target.substr(0, target.find('?')) == METRICS_TARGET) {
+        serveMetrics(send);
+        return;
     }
-       
-    boost::beast::http::string_body::value_type body = serverImpl.httpMessage;
+
+    const AssetBundle::Asset* asset = serverImpl.assets.find(target);
+    if (!asset) {
+        send(errorResponse(boost::beast::http::status::not_found, "Unknown request-target"));
+        return;
+    }
+
+    auto encoding = asset->selectEncoding(
+        toStringView(request[boost::beast::http::field::accept_encoding]));
+    const auto& variant = asset->variants[static_cast<size_t>(encoding)];
 
     auto addResponseMetaData =
-        [bodySize = body.size(), &request = this->request] (auto& response) {
+        [asset, encoding, &variant, &request = this->request] (auto& response) {
         response.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
-        response.set(boost::beast::http::field::content_type, "text/html");
-        response.content_length(bodySize);
+        response.set(boost::beast::http::field::content_type, asset->contentType);
+        response.set(boost::beast::http::field::cache_control, asset->cacheControl);
+        response.set(boost::beast::http::field::etag, variant.etag);
+        response.set(boost::beast::http::field::vary, "Accept-Encoding");
+        if (encoding != AssetBundle::Encoding::Identity) {
+            response.set(boost::beast::http::field::content_encoding,
+                         encoding == AssetBundle::Encoding::Gzip ? "gzip" : "br");
+        }
         response.keep_alive(request.keep_alive());
     };
 
-    if (request.method() == boost::beast::http::verb::head) {
+    if (asset->isCurrent(toStringView(request[boost::beast::http::field::if_none_match]), encoding)) {
+        // Respond to a conditional request for content the client already has
+        boost::beast::http::response<boost::beast::http::empty_body> result {
+            boost::beast::http::status::not_modified,
+            request.version()
+        };
+        addResponseMetaData(result);
+        send(std::move(result));
+    } else if (request.method() == boost::beast::http::verb::head) {
         // Respond to HEAD
         boost::beast::http::response<boost::beast::http::empty_body> result {
             boost::beast::http::status::ok,
             request.version()
         };
         addResponseMetaData(result);
+        result.content_length(variant.body.size());
         send(std::move(result));
     } else {
-        // Respond to GET
-        boost::beast::http::response<boost::beast::http::string_body> result {
+        // Respond to GET, the body refers to the asset rather than copying it
+        boost::beast::http::response<boost::beast::http::span_body<const char>> result {
             std::piecewise_construct,
-            std::make_tuple(std::move(body)),
+            std::make_tuple(variant.body.data(), variant.body.size()),
             std::make_tuple(boost::beast::http::status::ok, request.version())
         };
         addResponseMetaData(result);
+        result.content_length(variant.body.size());
+        send(std::move(result));
+    }
+}
+
+
+template <typename Send>
+void HTTPSession::serveMetrics(Send& send) {
+    std::string exposition = serverImpl.metrics.exposition();
+    auto addResponseMetaData = [&request = this->request] (auto& response) {
+        response.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
+        response.set(boost::beast::http::field::content_type, "text/plain; version=0.0.4; charset=utf-8");
+        response.set(boost::beast::http::field::cache_control, "no-store");
+        response.keep_alive(request.keep_alive());
+    };
+
+    if (request.method() == boost::beast::http::verb::head) {
+        boost::beast::http::response<boost::beast::http::empty_body> result {
+            boost::beast::http::status::ok,
+            request.version()
+        };
+        addResponseMetaData(result);
+        result.content_length(exposition.size());
+        send(std::move(result));
+    } else {
+        boost::beast::http::response<boost::beast::http::string_body> result {
+            boost::beast::http::status::ok,
+            request.version()
+        };
+        addResponseMetaData(result);
+        result.body() = std::move(exposition);
+        result.prepare_payload();
         send(std::move(result));
     }
 }
@@ -302,26 +1095,142 @@ void HTTPSession::handleRequest() {
 /////////////////////////////////////////////////////////////////////////////
 
 
-void ServerImpl::listenForConnections() {
-    auto session = std::make_shared<HTTPSession>(*this);
+ServerImpl::ServerImpl(Server& server, unsigned short port, AssetBundle assets, const ServerOptions& options)
+    : server{server},
+    endpoint{boost::asio::ip::tcp::v4(), port},
+    assets{std::move(assets)},
+    compression{options.compression},
+    backpressure{options.backpressure},
+    keepalive{options.keepalive},
+    listening{options.listening},
+    rateLimit{options.rateLimit},
+    threaded{options.ioThreads > 0},
+    workers{[this, ioThreads = options.ioThreads] () {
+        std::vector<std::unique_ptr<IOWorker>> workers;
+        for (size_t i = 0; i < std::max(1u, ioThreads); i++) {
+            workers.push_back(std::make_unique<IOWorker>(*this, i));
+        }
+        return workers;
+    }()},
+    openConnections{metrics.gauge("socialgaming_connections",
+        "Open websocket connections.")},
+    acceptedConnections{metrics.counter("socialgaming_accepted_connections_total",
+        "TCP connections accepted.")},
+    failedAccepts{metrics.counter("socialgaming_failed_accepts_total",
+        "Accepts that failed, e.g. for lack of file descriptors.")},
+    messagesReceived{metrics.counter("socialgaming_messages_received_total",
+        "Websocket messages received and queued for the server.")},
+    bytesReceived{metrics.counter("socialgaming_received_bytes_total",
+        "Bytes of the websocket messages received.")},
+    messagesSent{metrics.counter("socialgaming_messages_sent_total",
+        "Websocket messages written to clients.")},
+    bytesSent{metrics.counter("socialgaming_sent_bytes_total",
+        "Bytes of the websocket messages written, before compression.")},
+    droppedChat{metrics.counter("socialgaming_dropped_chat_messages_total",
+        "Chat messages dropped for congested connections.")},
+    congestionEvictions{metrics.counter("socialgaming_congestion_evictions_total",
+        "Connections closed for staying congested past the grace period.")},
+    idleEvictions{metrics.counter("socialgaming_idle_evictions_total",
+        "Connections closed for staying silent past the idle timeout.")},
+    rateLimitedMessages{metrics.counter("socialgaming_rate_limited_messages_total",
+        "Messages and frames of the binary protocol dropped for exceeding the rate limit.")},
+    rateLimitDisconnects{metrics.counter("socialgaming_rate_limit_disconnects_total",
+        "Connections closed for exceeding the rate limit.")} {
+    // all acceptors are open before the first accept, so none of them moves while in use
+    bool perWorker = threaded && listening.acceptorPerThread;
+    size_t numAcceptors = perWorker ? workers.size() : 1;
+    for (size_t i = 0; i < numAcceptors; i++) {
+        acceptors.push_back(openAcceptor(workers[i]->ioContext, perWorker));
+    }
+    for (size_t i = 0; i < numAcceptors; i++) {
+        for (unsigned accept = 0; accept < std::max(1u, listening.pendingAccepts); accept++) {
+            listenForConnections(i);
+        }
+    }
+    if (threaded) {
+        for (auto& worker : workers) {
+            worker->start();
+        }
+    }
+}
+
+
+ServerImpl::~ServerImpl() {
+    // the workers must be stopped before the acceptors they use go away
+    for (auto& worker : workers) {
+        worker->stop();
+    }
+}
+
+
+boost::asio::ip::tcp::acceptor
+ServerImpl::openAcceptor(boost::asio::io_context& ioContext, bool reusePort) {
+    using ReusePort = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+    boost::asio::ip::tcp::acceptor acceptor{ioContext};
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    if (reusePort) {
+        // the kernel spreads incoming connections over the acceptors of the workers
+        acceptor.set_option(ReusePort(true));
+    }
+    acceptor.bind(endpoint);
+    acceptor.listen(listening.backlog);
+    return acceptor;
+}
+
+
+void ServerImpl::listenForConnections(size_t acceptor) {
+    // a shared acceptor hands the new connections to the workers round robin
+    IOWorker& worker = acceptors.size() == workers.size()
+        ? *workers[acceptor]
+        : *workers[nextWorker++ % workers.size()];
 
-    acceptor.async_accept(session->getSocket(),
-        [this, session] (auto errorCode) {
+    acceptors[acceptor].async_accept(worker.ioContext,
+        [this, acceptor, &worker] (auto errorCode, boost::asio::ip::tcp::socket socket) {
+            if (errorCode == boost::asio::error::operation_aborted) {
+                return;
+            }
             if (!errorCode) {
-                session->start();
-            } else {
-                reportError("Fatal error while accepting");
+                acceptedConnections.add();
+                boost::asio::dispatch(worker.ioContext,
+                    [&worker, socket = std::move(socket)] () mutable {
+                        worker.startSession(std::move(socket));
+                    });
+                listenForConnections(acceptor);
+                return;
             }
-            this->listenForConnections();
+
+            failedAccepts.add();
+            reportError("Error while accepting");
+            // errors such as running out of file descriptors last a while, so the accept
+            // is retried after a pause rather than failing again straight away
+            auto retry = std::make_shared<boost::asio::steady_timer>(
+                acceptors[acceptor].get_executor(), ACCEPT_RETRY_INTERVAL);
+            retry->async_wait([this, acceptor, retry] (auto errorCode) {
+                if (!errorCode) {
+                    listenForConnections(acceptor);
+                }
+            });
         }
     );
 }
 
 
-void ServerImpl::registerChannel(Channel& channel) {
-    auto user = channel.getConnection();
-    channels[user] = channel.shared_from_this();
-    server.connectionHandler->handleConnect(user);
+void ServerImpl::processConnectionEvents() {
+    ConnectionEvent event;
+    while (connectionEvents.pop(event)) {
+        if (event.connected) {
+            users[event.user] = {event.worker, std::move(event.writes)};
+            server.connectionHandler->handleConnect(event.user);
+        } else {
+            if (users.erase(event.user)) {
+                // users disconnected through Server::disconnect() were already reported
+                server.connectionHandler->handleDisconnect(event.user);
+            }
+            userIds.release(event.user);
+        }
+    }
 }
 
 
@@ -329,6 +1238,209 @@ void ServerImpl::reportError(std::string_view /*message*/) {
     // Swallow errors....
 }
 
+/////////////////////////////////////////////////////////////////////////////
+// I/O workers
+/////////////////////////////////////////////////////////////////////////////
+
+
+IOWorker::IOWorker(ServerImpl& serverImpl, size_t index)
+    : serverImpl{serverImpl},
+    index{index},
+    ioContext{},
+    retryTimer{ioContext},
+    keepaliveEnabled{serverImpl.keepalive.idleTimeout.count() > 0},
+    keepaliveTickInterval{std::max(std::chrono::milliseconds{1},
+                                   serverImpl.keepalive.idleTimeout / KEEPALIVE_TICKS_PER_TIMEOUT)},
+    pingTicks{static_cast<uint64_t>((serverImpl.keepalive.pingInterval + keepaliveTickInterval
+                                     - std::chrono::milliseconds{1}) / keepaliveTickInterval)},
+    idleTicks{static_cast<uint64_t>((serverImpl.keepalive.idleTimeout + keepaliveTickInterval
+                                     - std::chrono::milliseconds{1}) / keepaliveTickInterval)},
+    keepaliveWheel{idleTicks + 2},
+    keepaliveTimer{ioContext} {
+    if (keepaliveEnabled) {
+        keepaliveTimer.expires_after(keepaliveTickInterval);
+        keepaliveTimer.async_wait([this] (auto errorCode) {
+            if (!errorCode) {
+                turnKeepaliveWheel();
+            }
+        });
+    }
+}
+
+
+void IOWorker::start() {
+    thread = std::thread([this] () {
+        auto work = boost::asio::make_work_guard(ioContext);
+        ioContext.run();
+    });
+}
+
+
+void IOWorker::stop() {
+    if (thread.joinable()) {
+        ioContext.stop();
+        thread.join();
+    }
+}
+
+
+void IOWorker::startSession(boost::asio::ip::tcp::socket socket) {
+    std::unique_ptr<HTTPSession> session;
+    if (freeSessions.empty()) {
+        session = std::make_unique<HTTPSession>(*this);
+    } else {
+        session = std::move(freeSessions.back());
+        freeSessions.pop_back();
+    }
+
+    // the session returns to the pool once the last handler holding it is done
+    std::shared_ptr<HTTPSession> shared{session.release(), [this] (HTTPSession* session) {
+        recycleSession(session);
+    }};
+    shared->start(std::move(socket));
+}
+
+
+void IOWorker::recycleSession(HTTPSession* session) {
+    session->clear();
+    if (freeSessions.size() < FREE_SESSIONS_PER_WORKER) {
+        freeSessions.emplace_back(session);
+    } else {
+        delete session;
+    }
+}
+
+
+void IOWorker::registerChannel(Channel& channel) {
+    auto user = channel.getConnection();
+    channels[user] = channel.shared_from_this();
+    if (keepaliveEnabled) {
+        keepaliveWheel.schedule(user, keepaliveWheel.now() + pingTicks);
+    }
+    serverImpl.openConnections.add(1);
+    reportConnectionEvent({user, index, true, channel.getWriteGauge()});
+}
+
+
+void IOWorker::turnKeepaliveWheel() {
+    // rearmed from the previous expiry, so the wheel does not drift behind the clock
+    keepaliveTimer.expires_at(keepaliveTimer.expiry() + keepaliveTickInterval);
+    keepaliveTimer.async_wait([this] (auto errorCode) {
+        if (!errorCode) {
+            turnKeepaliveWheel();
+        }
+    });
+    keepaliveWheel.advance([this] (User user) { checkIdle(user); });
+}
+
+
+void IOWorker::checkIdle(User user) {
+    auto found = channels.find(user);
+    if (nullptr == found) {
+        return; // closed since it was scheduled
+    }
+    // the channel is kept alive while it is checked, evicting it drops it from channels
+    auto channel = *found;
+    uint64_t next = channel->checkIdle(keepaliveWheel.now(), pingTicks, idleTicks);
+    if (0 != next) {
+        keepaliveWheel.schedule(user, next);
+    }
+}
+
+
+void IOWorker::channelClosed(User user) {
+    auto found = channels.find(user);
+    if (nullptr != found) {
+        (*found)->disconnect();
+        channels.erase(user);
+        serverImpl.openConnections.add(-1);
+        reportConnectionEvent({user, index, false});
+    }
+}
+
+
+void IOWorker::reportConnectionEvent(ConnectionEvent event) {
+    unsentEvents.push_back(event);
+    flushConnectionEvents();
+}
+
+
+void IOWorker::flushConnectionEvents() {
+    while (!unsentEvents.empty() && serverImpl.connectionEvents.push(std::move(unsentEvents.front()))) {
+        unsentEvents.pop_front();
+    }
+    if (unsentEvents.empty() || retryPending) {
+        return;
+    }
+
+    retryPending = true;
+    retryTimer.expires_after(QUEUE_RETRY_INTERVAL);
+    retryTimer.async_wait([this] (auto errorCode) {
+        retryPending = false;
+        if (!errorCode) {
+            flushConnectionEvents();
+        }
+    });
+}
+
+
+void IOWorker::drainOutbound() {
+    // cleared first, so anything posted while draining schedules another drain
+    drainScheduled = false;
+
+    Outbound item;
+    while (outbound.pop(item)) {
+        deliverOutbound(std::move(item));
+    }
+}
+
+
+void IOWorker::deliverOutbound(Outbound item) {
+    auto found = channels.find(item.user);
+    if (nullptr == found) {
+        return;
+    }
+    if (item.disconnect) {
+        (*found)->disconnect();
+        channels.erase(item.user);
+        serverImpl.openConnections.add(-1);
+        // the thread using the Server already forgot the user
+        serverImpl.userIds.release(item.user);
+    } else {
+        (*found)->send(std::move(item));
+    }
+}
+
+
+void IOWorker::post(Outbound item) {
+    unsentOutbound.push_back(std::move(item));
+    flushOutbound();
+}
+
+
+void IOWorker::flushOutbound() {
+    if (unsentOutbound.empty()) {
+        return;
+    }
+    if (!serverImpl.threaded) {
+        // this thread runs the io_context, so the writes start right away instead of
+        // waiting for the next Server::update()
+        while (!unsentOutbound.empty()) {
+            Outbound item = std::move(unsentOutbound.front());
+            unsentOutbound.pop_front();
+            deliverOutbound(std::move(item));
+        }
+        return;
+    }
+    while (!unsentOutbound.empty() && outbound.push(std::move(unsentOutbound.front()))) {
+        unsentOutbound.pop_front();
+    }
+    if (!drainScheduled.exchange(true)) {
+        boost::asio::post(ioContext, [this] () { drainOutbound(); });
+    }
+}
+
+
 void ServerImplDeleter::operator()(ServerImpl* serverImpl) {
     // NOTE: This is a custom deleter used to help hide the impl class. Thus
     // it must use a raw delete.
@@ -342,46 +1454,83 @@ void ServerImplDeleter::operator()(ServerImpl* serverImpl) {
 /////////////////////////////////////////////////////////////////////////////
 
 void Server::update() {
-    impl->ioContext.poll();
+    if (!impl->threaded) {
+        impl->workers.front()->ioContext.poll();
+    }
+    for (auto& worker : impl->workers) {
+        worker->flushOutbound();
+    }
+    impl->processConnectionEvents();
 }
 
 
 std::deque<Message> Server::receive() {
-    std::deque<Message> oldIncoming;
-    std::swap(oldIncoming, impl->incoming);
-    return oldIncoming;
+    // report the connections of the users the messages are from before handing them out
+    impl->processConnectionEvents();
+
+    std::deque<Message> incoming;
+    impl->incoming.popBatch(incoming);
+    return incoming;
 }
 
 
-void Server::send(const std::deque<Message>& messages) {
+void Server::send(std::deque<Message>&& messages) {
     for (auto& message : messages) {
-        auto found = impl->channels.find(message.user);
-        if (impl->channels.end() != found) {
-            found->second->send(message.text);
+        auto found = impl->users.find(message.user);
+        if (nullptr != found) {
+            impl->workers[found->worker]->post({message.user, std::move(message.text), std::move(message.payload),
+                                                false, message.priority, std::move(message.event)});
         }
     }
+    messages.clear();
 }
 
 
 void Server::disconnect(User user) {
-    auto found = impl->channels.find(user);
-    if (impl->channels.end() != found) {
+    auto found = impl->users.find(user);
+    if (nullptr != found) {
         connectionHandler->handleDisconnect(user);
-        found->second->disconnect();
-        impl->channels.erase(found);
+        impl->workers[found->worker]->post({user, "", nullptr, true});
+        impl->users.erase(user);
+    }
+}
+
+
+AcceptStats Server::acceptStats() const {
+    return {impl->acceptedConnections.value(), impl->failedAccepts.value()};
+}
+
+
+RateLimitStats Server::rateLimitStats() const {
+    return {impl->rateLimitedMessages.value(), impl->rateLimitDisconnects.value()};
+}
+
+
+Metrics& Server::metrics() {
+    return impl->metrics;
+}
+
+
+QueuedWrites Server::queuedWrites(User user) const {
+    auto found = impl->users.find(user);
+    if (nullptr == found) {
+        return {};
     }
+    return {found->writes->bytes.load(std::memory_order_relaxed),
+            found->writes->messages.load(std::memory_order_relaxed)};
 }
 
 
 std::unique_ptr<ServerImpl,ServerImplDeleter>
 Server::buildImpl(Server& server,
                   unsigned short port,
-                  std::string httpMessage) {
+                  AssetBundle assets,
+                  const ServerOptions& options) {
     // NOTE: We are using a custom deleter here so that the impl class can be
     // hidden within the source file rather than exposed in the header. Using
     // a custom deleter means that we need to use a raw `new` rather than using
     // `std::make_unique`.
-    auto* impl = new ServerImpl(server, port, std::move(httpMessage));
+    auto* impl = new ServerImpl(server, port, std::move(assets), options);
     return std::unique_ptr<ServerImpl,ServerImplDeleter>(impl);
 }
 
@@ -0,0 +1,131 @@
+#include "tickProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+namespace {
+
+std::string
+formatMilliseconds(double microseconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f ms", microseconds / 1000);
+    return text;
+}
+
+
+uint64_t
+toMicroseconds(TickProfiler::Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+
+// a row of dump(): the name, then the number of samples, mean, median, 99th percentile and maximum in ms
+std::string
+formatRow(const std::string& name, const Histogram& histogram) {
+    uint64_t count = histogram.count();
+    double mean = count == 0 ? 0 : static_cast<double>(histogram.sum()) / count;
+    char row[160];
+    std::snprintf(row, sizeof(row), "%-24s %10llu %10.3f %10.3f %10.3f %10.3f\n",
+                  name.c_str(), static_cast<unsigned long long>(count), mean / 1000,
+                  histogram.quantile(0.5) / 1000.0, histogram.quantile(0.99) / 1000.0,
+                  histogram.quantile(1) / 1000.0);
+    return row;
+}
+
+}
+
+
+TickProfiler::TickProfiler(Metrics& metrics, std::chrono::microseconds budget)
+    : budget{budget},
+    tickDuration{metrics.histogram("socialgaming_tick_seconds",
+        "Time taken by a tick of the main loop.", 1e-6)},
+    ticksOverBudget{metrics.counter("socialgaming_ticks_over_budget_total",
+        "Ticks of the main loop that took longer than their budget.")},
+    metrics{metrics}
+{ }
+
+
+size_t
+TickProfiler::addPhase(const std::string& name) {
+    Histogram& histogram = metrics.histogram("socialgaming_tick_phase_seconds",
+        "Time taken by a phase of the main loop per tick, by phase.", 1e-6, "phase=\"" + name + "\"");
+    phases.push_back({name, histogram});
+    return phases.size() - 1;
+}
+
+
+void
+TickProfiler::beginTick() {
+    for (auto& phase : phases) {
+        phase.elapsed = {};
+        phase.ran = false;
+    }
+    tickStart = Clock::now();
+}
+
+
+bool
+TickProfiler::endTick() {
+    auto elapsed = Clock::now() - tickStart;
+    ticks++;
+
+    lastTick.tick = ticks;
+    lastTick.elapsed = elapsed;
+    lastTick.phases.clear();
+    for (size_t i = 0; i < phases.size(); i++) {
+        if (phases[i].ran) {
+            phases[i].histogram.record(toMicroseconds(phases[i].elapsed));
+            lastTick.phases.emplace_back(i, phases[i].elapsed);
+        }
+    }
+    tickDuration.record(toMicroseconds(elapsed));
+    if (slowestTick.elapsed < elapsed) {
+        slowestTick = lastTick;
+    }
+
+    bool overBudget = budget < elapsed;
+    if (overBudget) {
+        ticksOverBudget.add();
+    }
+    return overBudget;
+}
+
+
+std::string
+TickProfiler::describe(const TickRecord& record) const {
+    std::string text = "tick " + std::to_string(record.tick)
+        + " took " + formatMilliseconds(toMicroseconds(record.elapsed))
+        + " (budget " + formatMilliseconds(budget.count()) + ")";
+    const char* separator = ": ";
+    for (auto [phase, elapsed] : record.phases) {
+        text += separator + phases[phase].name + " " + formatMilliseconds(toMicroseconds(elapsed));
+        separator = ", ";
+    }
+    return text;
+}
+
+
+std::string
+TickProfiler::describeLastTick() const {
+    return describe(lastTick);
+}
+
+
+std::string
+TickProfiler::dump() const {
+    std::string text = std::to_string(ticks) + " ticks, " + std::to_string(ticksOverBudget.value())
+        + " over the budget of " + formatMilliseconds(budget.count()) + "\n";
+    char header[160];
+    std::snprintf(header, sizeof(header), "%-24s %10s %10s %10s %10s %10s\n",
+                  "phase", "ticks", "mean ms", "p50 ms", "p99 ms", "max ms");
+    text += header;
+    for (const auto& phase : phases) {
+        text += formatRow(phase.name, phase.histogram);
+    }
+    text += formatRow("tick", tickDuration);
+    if (0 < ticks) {
+        text += "slowest " + describe(slowestTick) + "\n";
+    }
+    return text;
+}
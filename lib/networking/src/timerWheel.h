@@ -0,0 +1,48 @@
+#pragma once
+
+#include "server.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ *  A hashed timer wheel of Users. A User is scheduled on a future tick and handed back
+ *  when the wheel reaches that tick. Scheduling and expiring cost the same however many
+ *  Users are scheduled, and the owner drives the whole wheel with a single timer calling
+ *  advance() once per tick. Ticks further ahead than one revolution are clamped to the
+ *  last tick of the revolution, so an expired User has to be checked and rescheduled by
+ *  the owner.
+ */
+class TimerWheel {
+public:
+    explicit TimerWheel(size_t numSlots)
+        : slots(std::max<size_t>(2, numSlots))
+    { }
+
+    [[nodiscard]] uint64_t now() const noexcept { return current; }
+
+    void schedule(User user, uint64_t tick) {
+        tick = std::clamp<uint64_t>(tick, current + 1, current + slots.size() - 1);
+        slots[tick % slots.size()].push_back(user);
+    }
+
+    /**
+     *  Moves the wheel to the next tick and calls expire(User) for every User scheduled
+     *  on it. expire may schedule the User again.
+     */
+    template <typename Expire>
+    void advance(Expire expire) {
+        current++;
+        expired.swap(slots[current % slots.size()]);
+        for (User user : expired) {
+            expire(user);
+        }
+        expired.clear();
+    }
+
+private:
+    std::vector<std::vector<User>> slots;
+    std::vector<User> expired; // swapped with the slot being expired, so both keep their capacity
+    uint64_t current = 0;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "game.h"
+#include "server.h"
+
+/**
+ * Encoders of the structured events sent to clients of the binary protocol (see Protocol).
+ * Each appends one frame to frames, so several events can travel in one Message::event.
+ */
+void appendPromptEvent(std::string& frames, const InputRequest& request);
+void appendScoresEvent(std::string& frames, const ScoreTable& scores);
+void appendGameStateEvent(std::string& frames, GameStateChange change, uintptr_t gameID);
+
+/**
+ * The event announcing a change of the state of a game, built once and shared by its players
+ */
+Payload gameStateEvent(GameStateChange change, uintptr_t gameID);
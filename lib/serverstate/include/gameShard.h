@@ -0,0 +1,203 @@
+#pragma once
+
+#include "game.h"
+#include "metrics.h"
+#include "server.h"
+#include "spscQueue.h"
+#include "userTable.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Bounds on the game logic executed per server tick
+ *  - steps_per_game : rule steps a game may execute before it yields to the other games (see ExecutionBudget)
+ *  - tick_time_budget : time a shard may spend running games per tick, games that did not get to
+ *    run are resumed first on the next tick
+ */
+struct ExecutionLimits {
+    unsigned steps_per_game = 500;
+    std::chrono::microseconds tick_time_budget{20000};
+};
+
+/**
+ * The metrics kept up to date by the shards, every shard adds its share
+ *  - games : the games on the shards, by GameStatus
+ *  - pending_input_requests : input requests of those games that wait for a player
+ *  - tick_duration : time taken by each GameShard::tick()
+ */
+struct ShardMetrics {
+    explicit ShardMetrics(Metrics& metrics);
+
+    std::array<Gauge*, GameStatus::AwaitingOutput + 1> games;
+    Gauge& pending_input_requests;
+    Histogram& tick_duration;
+};
+
+/**
+ * Work sent from the network thread to the shard that owns a game
+ *  - StartGame : the shard takes ownership of game and starts running it
+ *  - PlayerInput : user entered input while in the game, a client of the binary protocol sends
+ *    the index of a choice, which is carried as choice instead of input
+ *  - RemovePlayer : user left the game
+ *  - EndGame : the game was ended by its owner, the shard drops it
+ */
+struct ShardCommand {
+    enum Type {
+        StartGame,
+        PlayerInput,
+        RemovePlayer,
+        EndGame
+    };
+
+    Type type = Type::EndGame;
+    uintptr_t gameID = 0;
+    User user{};
+    std::string input;
+    std::unique_ptr<Game> game;
+    std::optional<uint32_t> choice;
+};
+
+/**
+ * A partition of the running games.
+ *
+ * The shard owns its games outright, they are only ever touched by the thread calling tick():
+ * either the shard's own worker thread (see start()) or, when the server runs without worker
+ * threads, the thread calling GlobalServerState::processGames(). The network thread talks to
+ * the shard exclusively through post() and collect(), which move commands in and messages out
+ * over bounded lock-free queues, so game state needs no locks.
+ */
+class GameShard {
+public:
+    static constexpr size_t QUEUE_CAPACITY = 4096;
+
+    GameShard(unsigned update_interval, ExecutionLimits limits, ShardMetrics& metrics);
+    ~GameShard();
+
+    GameShard(const GameShard&) = delete;
+    GameShard& operator=(const GameShard&) = delete;
+
+    // NETWORK THREAD METHODS
+
+    /**
+     * Sends a command to the shard. Commands that do not fit in the queue are kept, in order,
+     * and retried by the next post() or collect().
+     */
+    void post(ShardCommand command);
+
+    /**
+     * Moves the messages produced by the shard to outgoing and the ids of the games
+     * that finished (and were dropped by the shard) to finished_games.
+     */
+    void collect(std::deque<Message>& outgoing, std::vector<uintptr_t>& finished_games);
+
+    /**
+     * Runs tick() every update_interval on a dedicated worker thread until the shard is destroyed
+     */
+    void start();
+
+    // SHARD THREAD METHODS
+
+    /**
+     * Handles the commands posted since the last tick, then processes the games that are ready
+     * - Resumes games that yielded, round robin within the ExecutionLimits
+     * - Sends out any player prompts to the respective players
+     * - Sends out any game output to the main screen
+     * - Registers player input that has been received or timed out
+     * - Drops games that are finished
+     * Games waiting on input are not visited until an event for them arrives, so the cost
+     * of a tick depends on the number of events rather than on the number of games.
+     */
+    void tick();
+
+private:
+    unsigned update_interval;
+    ExecutionLimits limits;
+    ShardMetrics& metrics;
+
+    // QUEUES BETWEEN THE THREADS
+
+    SPSCQueue<ShardCommand> inbox{QUEUE_CAPACITY};
+    SPSCQueue<Message> outbox{QUEUE_CAPACITY};
+    SPSCQueue<uintptr_t> finished_outbox{QUEUE_CAPACITY};
+    std::deque<ShardCommand> unposted_commands; // network thread side of inbox
+    std::deque<Message> unsent_messages;        // shard thread side of outbox
+    std::deque<uintptr_t> unsent_finished;      // shard thread side of finished_outbox
+
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    // SHARD THREAD STATE
+
+    struct GameInput {
+        std::string input;
+        std::optional<uint32_t> choice; // sent by a client of the binary protocol instead of input
+        bool new_input = false;
+        uint64_t timeout_tick = 0; // tick at which the pending input request times out, 0 if it has none
+    };
+    UserTable<GameInput> user_game_input;
+
+    /**
+     * An input request timeout, fires on the first tick at or after tick.
+     * Timeouts are never removed from the heap, one that no longer matches the
+     * user's GameInput::timeout_tick is stale and ignored when it fires.
+     */
+    struct InputTimeout {
+        uint64_t tick;
+        uintptr_t gameID;
+        User user;
+        bool operator>(const InputTimeout& other) const { return tick > other.tick; }
+    };
+    std::priority_queue<InputTimeout, std::vector<InputTimeout>, std::greater<InputTimeout>> input_timeouts;
+
+    uint64_t current_tick = 0; // number of tick() calls so far
+    std::unordered_map<uintptr_t, Game> games;
+
+    // games with pending work, in the order tick() visits them
+    std::deque<uintptr_t> ready_games;
+    std::unordered_set<uintptr_t> ready_game_set;
+
+    void flushQueues();
+    void handleCommand(ShardCommand& command);
+
+    /**
+     * Queues the game for the next tick(). Called when one of its players sends input,
+     * an input request times out, or the game has output pending or yielded.
+     * Queuing a game that is already queued does nothing.
+     */
+    void markGameReady(uintptr_t gameID);
+    void fireInputTimeouts();
+
+    /**
+     * Does the pending work of a ready game. Returns true if the game is still ready afterwards.
+     */
+    bool processReadyGame(Game& game, ExecutionBudget::Clock::time_point deadline);
+    void processGameMsgs(Game& game);
+    void processGameInput(Game& game);
+    void finishGame(Game& game);
+
+    /**
+     * Runs the game within the per game step budget, stopping at the tick deadline.
+     */
+    void runGame(Game& game, ExecutionBudget::Clock::time_point deadline);
+
+    void send(Message message);
+
+    /**
+     * Adds (sign 1) or takes back (sign -1) the share of game in the metrics. Called
+     * around everything that changes the status or the input requests of a game, so the
+     * metrics follow the games without visiting the idle ones.
+     */
+    void countGame(Game& game, int sign);
+};
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "game.h"
+#include "gameShard.h"
+#include "compiledGame.h"
 #include "server.h"
+#include "userTable.h"
 #include "InterpretJson.h"
+#include "lobbyRooms.h"
+#include "matchmaker.h"
 
 #include <algorithm>
+#include <memory>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
@@ -15,16 +21,52 @@
  *  - all the clients connected to server as a whole and by game
  *  - various game instances
  *  - various games that are available to play
+ *
+ * GlobalServerState lives on the network thread. Games are built and joined there, and
+ * moved to one of the GameShards when they start. From then on the network thread only
+ * keeps the routing information of the game (see GameInfo) and exchanges input and
+ * messages with the shard.
  */
 class GlobalServerState {
 public:
-    GlobalServerState(unsigned update_interval) 
-        : update_interval(update_interval) { 
-        populateGameList(); 
+    /**
+     * Everything the network thread knows about a connected user, in a single record so that
+     * handling a message takes one lookup (see getSession())
+     *  - location : where the user is, users are Connected until they pick a name
+     *  - game : the game the user is in when InGame, as its owner if owner is set
+     * The input a user sends to a running game is kept by the shard running it (see GameShard).
+     */
+    struct Session {
+        enum Location { Connected, InLobby, InGame };
+
+        std::string name;
+        Location location = Connected;
+        uintptr_t game = 0;
+        bool owner = false;
     };
 
+    /**
+     * worker_threads : number of shards that run games on their own thread, with 0 the games
+     *                  run on a single shard driven by processGames()
+     * lobby_limits : size of the lobby shards and their chat digests (see LobbyRooms)
+     * metrics : the registry the games are counted in, e.g. Server::metrics(), without one
+     *           they are counted in a registry of their own
+     */
+    GlobalServerState(unsigned update_interval, ExecutionLimits limits = {}, unsigned worker_threads = 0,
+                      LobbyLimits lobby_limits = {}, Metrics* metrics = nullptr);
+
+    /**
+     * The registry the games are counted in, commands register their metrics here too
+     */
+    Metrics& metrics() { return metrics_registry; }
+
     // SERVER AND COMMAND SPECIFIC METHODS
 
+    /**
+     * Returns the session of user, nullptr if user is not connected
+     */
+    const Session* getSession(User user);
+
     /**
      * Connects new users to the server for the very first time and adds them to  the respective lists.
      * NOTE: clears the users vector after adding all users
@@ -34,9 +76,18 @@ public:
     /**
      * This methods is called when users disconnect from the server
      * (voluntarily byt entering exit or involuntarily by force closing the terminal)
+     * Drops the session of the user along with its lobby room and matchmaking queue entries
      */
     void disconnectUser(User);
 
+    /**
+     * Disconnects a batch of users that were lost at once (eg. when a network blip drops many
+     * connections). The users are removed from the sessions and the lobby in one sweep, and
+     * every affected game is handled once: games whose owner was lost end, other games drop
+     * all their lost players together. Builds one notice per affected game into outgoing.
+     */
+    void disconnectUsers(const std::vector<User>& users, std::deque<Message>& outgoing);
+
     /**
      * This method is called to help execution of JOIN command. It
      *   removes the client(user) from the server lobby and
@@ -45,8 +96,18 @@ public:
      */
     void addClientToGame(User, uintptr_t invitationCode);
 
+    /**
+     * Adds the client(user) to the lobby room they were last in (the main lobby for new users)
+     */
     void addClientToLobby(User);
 
+    /**
+     * This method is called to help execution of ROOM command. It
+     *  moves the client(user) to the lobby room with name, creating the room if needed.
+     *  Returns false if the name is not a valid room name (see LobbyLimits)
+     */
+    bool joinRoom(User, std::string_view room);
+
     /**
      * This method is called to help execution of LEAVE command. It
      *  removes the client from the game they are currently playing and
@@ -75,84 +136,153 @@ public:
     void endGame(User user);
 
     /**
-     * Processes all running games
-     * - Sends out any player prompts to the respective players
-     * - Sends out any game output to the main screen
-     * - Checks whether player input has been received
-     * - Ends games that are finished
+     * Helps execution of QUEUE command.
+     * Queues user for a game of the type with gameIndex (see Matchmaker), the game is
+     * created and started by processGames() once enough users are queued.
+     */
+    void queueForGame(User user, int gameIndex);
+
+    /**
+     * Forms and starts the games of the users queued since the last call, then collects the
+     * output of the running games (see GameShard::tick()), ticking the shard first when there
+     * are no worker threads, and moves the players of finished games back to the server lobby.
      * Returns a deque of Messages to be sent out by the server
      */
     std::deque<Message> processGames();
 
+    /**
+     * Loads a compiled game (see gamecompiler) from the shared object at path.
+     * Instances of that game are then built from the compiled game instead of interpreting its json.
+     * Returns false if the shared object is not a compiled game.
+     */
+    bool registerCompiledGame(const std::string& path);
+
     // GAME SPECIFIC METHODS
-    void constructGame(std::vector<Game>& game_instances, std::string game_name, User owner); 
+    Game constructGame(std::string game_name, User owner);
     std::string getGameNamesAsString();
     User getGameOwner(User user);
+    uintptr_t getGameID(User user);
     int getPlayerCount(User user);
     void setName(User user, std::string name);
     std::string getName(User user);
+    std::string getRoomName(User user);
+    std::string getRoomsAsString();
     bool isInLobby(User user);
     bool isInGame(User user);
     bool isGameIndex(int index);
+    std::string getGameName(int index);
+    size_t getQueueLength(int gameIndex);
     bool isOwner(User user);
     bool gameHasEnoughPlayers(User user);
     bool isOngoingGame(User user);
     bool isOngoingGame(uintptr_t invitation_code);
     bool isValidGameInvitation(uintptr_t invitation_code);
     void registerUserGameInput(User user, std::string input);
+    void registerUserGameInput(User user, uint32_t choice);
 
     // BROADCASTING METHODS
+    // NOTE: the messages are appended to outgoing, so callers can build straight into their outgoing queue.
+    // The text is built into a single Payload shared by all the recipients, as is the event for the
+    // clients of the binary protocol, if any (see Message)
 
     /**
      * Builds messages for the server lobby with text as the passed in string.
-     * Used to broadcast message to all the connected clients in server lobby
+     * Used to broadcast message to all the connected clients in server lobby, in every room
+     */
+    void buildMessagesForServerLobby(const std::string&, std::deque<Message>& outgoing);
+
+    /**
+     * Publishes a chat line from user to their lobby room. The line is sent with the
+     * other lines of the tick by buildLobbyDigest(), to the users in the same room shard
+     */
+    void publishLobbyMessage(User user, std::string_view text);
+
+    /**
+     * Builds one message per user in the server lobby, the users of a room shard all sharing
+     * the digest of the chat lines published there since the last call.
      */
-    std::deque<Message> buildMessagesForServerLobby(std::string);
+    void buildLobbyDigest(std::deque<Message>& outgoing);
 
     /**
      * Builds messages for the game (that has user with passed in user).
      * Used to broadcast passed in text to all other players.
      * NOTE: Doesn't send to owner or to current player <user>
      */
-    std::deque<Message> buildMsgsForOtherPlayers(std::string, User);
+    void buildMsgsForOtherPlayers(const std::string&, User, std::deque<Message>& outgoing, Payload event = {});
 
     /**
      * Builds messages for the game (that has user with passed in user).
      * Used to broadcast passed in text to all the players.
      * NOTE: Doesn't send to owner
      */
-    std::deque<Message> buildMsgsForAllPlayers(std::string, User);
+    void buildMsgsForAllPlayers(const std::string&, User, std::deque<Message>& outgoing);
 
     /**
      * Builds messages for the game (that has user with passed in user).
      * Used to broadcast passed in text to all the players. and the game owner (main screen)
      */
-    std::deque<Message> buildMsgsForAllPlayersAndOwner(std::string, User);
+    void buildMsgsForAllPlayersAndOwner(const std::string&, User, std::deque<Message>& outgoing, Payload event = {});
 
 private:
-    struct GameInput {
-        std::string input;
-        bool new_input;
-        int time_remaining;
+    /**
+     * What the network thread knows about a game. The game itself is held here until it
+     * starts, it is then moved to its shard and only the routing information is kept.
+     */
+    struct GameInfo {
+        uintptr_t id;
+        User owner;
+        std::vector<User> players;
+        unsigned min_players;
+        std::unique_ptr<Game> game; // nullptr once the game started
+        size_t shard = 0;           // the shard running the game once it started
+
+        bool started() const { return game == nullptr; }
     };
-    std::map<User, GameInput> user_game_input;
 
-    unsigned update_interval;
-    std::unordered_map<User, uintptr_t, UserHash> clients_in_games;
-    std::unordered_map<User, uintptr_t, UserHash> gameOwnerMap;
-    std::unordered_map<User, std::string, UserHash> userNames;
-    std::vector<User> clients;
-    std::vector<User> clients_in_lobby;
-    std::vector<Game> game_instances;
+    std::unique_ptr<Metrics> owned_metrics; // nullptr if a registry was passed in
+    Metrics& metrics_registry;
+    ShardMetrics shard_metrics;
+    Gauge& hosted_games;
+
+    bool threaded;
+    std::vector<std::unique_ptr<GameShard>> shards;
+
+    UserTable<Session> sessions;
+    LobbyRooms lobby;
+    std::unordered_map<uintptr_t, GameInfo> game_instances;
 
     std::unordered_map<int, std::string> gameNameList;
+    std::unordered_map<std::string, std::unique_ptr<CompiledGame>> compiledGames;
+
+    // games that are not compiled are built from their parsed configuration, the json is
+    // only read once per game type
+    std::unordered_map<std::string, std::unique_ptr<InterpretJson>> gameTemplates;
+    std::unordered_map<std::string, Game::PlayerCount> playerCounts;
+
+    Matchmaker matchmaker;
+
+    /**
+     * Creates and starts a game for every match the Matchmaker forms
+     */
+    void formQueuedGames(std::deque<Message>& outgoing);
+    Game::PlayerCount playerCountOf(const std::string& game_name);
 
     void populateGameList();
+
+    /**
+     * Moves the owner and players of the game to the server lobby and forgets the game
+     */
     void removeGameInstance(uintptr_t gameID);
 
-    void processGameMsgs(Game& game, std::deque<Message>& outgoing);
-    void finishGame(Game& game, std::deque<Message>& outgoing);
+    /**
+     * Moves a user who is in a game back to the lobby room they were in
+     */
+    void returnToLobby(User user);
 
+    /**
+     * Stops the game on its shard if it started and forgets it (see removeGameInstance())
+     */
+    void endGameInstance(uintptr_t gameID);
 
     /**
      *  A general function that can be used on any vector of Users to ease removing
@@ -161,8 +291,7 @@ private:
 
     // GAME INSTANCE METHODS
 
-    Game *getGameInstancebyUser(User user);
-    Game *getGameInstancebyOwner(User user);
-    Game *getGameInstancebyInvitation(uintptr_t invitationCode); // TODO: FIX Invitation code in game
-    Game *getGameInstancebyId(uintptr_t gameID);
+    GameInfo *getGameInstancebyUser(User user);
+    GameInfo *getGameInstancebyInvitation(uintptr_t invitationCode); // TODO: FIX Invitation code in game
+    GameInfo *getGameInstancebyId(uintptr_t gameID);
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "server.h"
+
+#include <string>
+#include <string_view>
+
+/**
+ * The chat channel of the server lobby.
+ *
+ * Chat lines published during a tick are collected into a single digest, which is sent once
+ * per tick as one Payload shared by every user in the lobby. A chat line therefore no longer
+ * costs one message per lobby user, and the number of messages per tick stays linear in the
+ * lobby population however many users are chatting.
+ * At most max_lines lines go into a digest, the lines after that are dropped and counted.
+ */
+class LobbyChat {
+public:
+    static constexpr size_t DEFAULT_MAX_LINES = 50;
+
+    explicit LobbyChat(size_t max_lines = DEFAULT_MAX_LINES);
+
+    /**
+     * Adds the line "<name> : <text>" to the digest of the current tick
+     */
+    void publish(std::string_view name, std::string_view text);
+
+    /**
+     * Returns the digest of the lines published since the last call and starts a new one.
+     * Returns nullptr if nothing was published.
+     */
+    Payload takeDigest();
+
+private:
+    size_t max_lines;
+    size_t num_lines = 0;
+    size_t num_dropped = 0;
+    std::string digest;
+};
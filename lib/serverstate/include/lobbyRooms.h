@@ -0,0 +1,111 @@
+#pragma once
+
+#include "lobbyChat.h"
+#include "server.h"
+#include "userTable.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Bounds on the server lobby
+ *  - shard_capacity : users per lobby shard, a room that is full overflows into a new shard
+ *  - digest_lines : chat lines sent per shard per tick (see LobbyChat)
+ *  - max_room_name : length of a room name
+ */
+struct LobbyLimits {
+    size_t shard_capacity = 500;
+    size_t digest_lines = LobbyChat::DEFAULT_MAX_LINES;
+    size_t max_room_name = 32;
+};
+
+/**
+ * The server lobby, made of named rooms.
+ *
+ * A room is split into shards of at most shard_capacity users, and every shard has its own
+ * chat. Chat lines only reach the users of the same shard, so the fan-out of a chat line is
+ * bounded by shard_capacity however many users are connected.
+ * Users that go to a game leave the lobby and come back to the room they were in.
+ * A shard is removed once its last user leaves, and a room with it.
+ */
+class LobbyRooms {
+public:
+    static constexpr std::string_view MAIN_ROOM = "lobby";
+
+    explicit LobbyRooms(LobbyLimits limits = {});
+
+    /**
+     * Adds user to room, in the first shard of the room with space for them.
+     * A user that is in another room moves to this one.
+     * Returns false, leaving user where they are, if the name is empty or longer than max_room_name.
+     */
+    bool join(User user, std::string_view room);
+
+    /**
+     * Adds user back to the room they were last in (MAIN_ROOM for new users)
+     */
+    void rejoin(User user);
+
+    /**
+     * Removes user from the lobby, the room is remembered for rejoin()
+     */
+    void leave(User user);
+
+    /**
+     * Removes user from the lobby and forgets their room
+     */
+    void forget(User user);
+
+    /**
+     * forget() for a batch of users, each shard they were in is swept once
+     */
+    void forgetAll(const std::vector<User>& users);
+
+    bool contains(User user) const;
+
+    /**
+     * Name of the room user is in (or was last in), with the shard number if the room has several
+     */
+    std::string roomName(User user) const;
+
+    /**
+     * Lists the rooms with the number of users in each
+     */
+    std::string roomsAsString() const;
+
+    void publish(User user, std::string_view name, std::string_view text);
+
+    /**
+     * Builds the chat digest of every shard for the users of that shard (see LobbyChat)
+     * The digests are sent as Priority::Chat, a user whose connection falls behind misses chat first
+     */
+    void buildDigests(std::deque<Message>& outgoing);
+
+    /**
+     * Builds a message sharing payload for every user in the lobby
+     */
+    void broadcast(const Payload& payload, std::deque<Message>& outgoing) const;
+
+private:
+    struct Shard {
+        std::string room;
+        size_t number;  // position of the shard within its room
+        std::vector<User> members;
+        LobbyChat chat;
+    };
+
+    LobbyLimits limits;
+    std::vector<Shard> shards;
+    std::unordered_map<std::string, std::vector<size_t>> room_shards; // room name -> shard indices
+    UserTable<size_t> user_shard;     // users in the lobby -> shard index
+    UserTable<std::string> user_room; // room each user belongs to
+
+    size_t findShard(const std::string& room);
+
+    /**
+     * Removes shard if it has no members. The last shard takes its index.
+     */
+    void removeIfEmpty(size_t shard);
+};
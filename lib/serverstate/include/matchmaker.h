@@ -0,0 +1,74 @@
+#pragma once
+
+#include "game.h"
+#include "server.h"
+#include "userTable.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+/**
+ * A group of queued users that together make up a game
+ *  - host : owns the game (main screen), as the user entering create would
+ *  - players : join the game, as users entering join would
+ */
+struct Match {
+    int game_index;
+    User host;
+    std::vector<User> players;
+};
+
+/**
+ * Queues of users waiting for a game, one per game type.
+ *
+ * Users are matched in batches: formMatches() turns each queue into as many games as its
+ * users allow, once per scheduling interval, instead of creating and joining games one
+ * command at a time. Enqueuing and removing users is constant time, removed users are
+ * skipped when their queue is next matched.
+ */
+class Matchmaker {
+public:
+    using PlayerCountLookup = std::function<Game::PlayerCount(int game_index)>;
+
+    /**
+     * Queues user for the game with game_index, in place of any game they were queued for
+     */
+    void enqueue(User user, int game_index);
+
+    /**
+     * Removes user from their queue, returns false if they were not queued
+     */
+    bool remove(User user);
+
+    bool isQueued(User user) const;
+
+    /**
+     * Number of users waiting for the game with game_index
+     */
+    size_t queueLength(int game_index) const;
+
+    /**
+     * Forms as many games as possible from every queue, in queue order. Each game gets a host
+     * and between the min and max players of its game type (given by player_count), preferring
+     * full games. Users that are not matched keep their place in the queue.
+     */
+    std::vector<Match> formMatches(const PlayerCountLookup& player_count);
+
+private:
+    struct Ticket {
+        User user;
+        uint64_t number;
+    };
+    struct Queued {
+        int game_index = 0;
+        uint64_t ticket = 0;
+    };
+
+    uint64_t next_ticket = 0;
+    std::map<int, std::deque<Ticket>> queues;          // ordered so games are formed in a stable order
+    UserTable<Queued> queued;                          // the ticket each queued user holds
+
+    bool isValid(const Ticket& ticket, int game_index) const;
+};
@@ -0,0 +1,46 @@
+#include "gameEvents.h"
+
+#include <algorithm>
+
+void appendPromptEvent(std::string& frames, const InputRequest& request) {
+    FrameWriter writer{frames, Opcode::Prompt};
+    writer.u32(request.has_timeout ? request.timeout_ms : 0);
+    writer.string(request.question.empty() ? request.prompt : request.question);
+    writer.u16(static_cast<uint16_t>(std::min<size_t>(request.choices.size(), UINT16_MAX)));
+    for (size_t i = 0; i < request.choices.size() && i < UINT16_MAX; i++) {
+        writer.string(request.choices[i]);
+    }
+    writer.finish();
+}
+
+void appendScoresEvent(std::string& frames, const ScoreTable& scores) {
+    size_t columns = std::min<size_t>(scores.columns.size(), UINT16_MAX);
+    size_t rows = std::min<size_t>(scores.rows.size(), UINT16_MAX);
+
+    FrameWriter writer{frames, Opcode::Scores};
+    writer.u16(static_cast<uint16_t>(columns));
+    for (size_t i = 0; i < columns; i++) {
+        writer.string(scores.columns[i]);
+    }
+    writer.u16(static_cast<uint16_t>(rows));
+    for (size_t i = 0; i < rows; i++) {
+        writer.string(scores.rows[i].player);
+        for (size_t column = 0; column < columns; column++) {
+            writer.i32(column < scores.rows[i].scores.size() ? scores.rows[i].scores[column] : 0);
+        }
+    }
+    writer.finish();
+}
+
+void appendGameStateEvent(std::string& frames, GameStateChange change, uintptr_t gameID) {
+    FrameWriter writer{frames, Opcode::GameState};
+    writer.u8(static_cast<uint8_t>(change));
+    writer.u64(gameID);
+    writer.finish();
+}
+
+Payload gameStateEvent(GameStateChange change, uintptr_t gameID) {
+    std::string frames;
+    appendGameStateEvent(frames, change, gameID);
+    return makePayload(std::move(frames));
+}
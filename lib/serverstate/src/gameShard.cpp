@@ -0,0 +1,322 @@
+#include "gameShard.h"
+#include "gameEvents.h"
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <glog/logging.h>
+
+ShardMetrics::ShardMetrics(Metrics& metrics)
+    : pending_input_requests(metrics.gauge("socialgaming_pending_input_requests",
+          "Input requests of the running games that wait for a player.")),
+      tick_duration(metrics.histogram("socialgaming_shard_tick_seconds",
+          "Time taken by a tick of a game shard.", 1e-6)) {
+    // indexed by GameStatus
+    constexpr const char* STATUS_NAMES[] = {"created", "running", "finished", "awaiting_input", "awaiting_output"};
+    static_assert(std::size(STATUS_NAMES) == std::tuple_size<decltype(games)>::value);
+    for (size_t status = 0; status < games.size(); status++) {
+        games[status] = &metrics.gauge("socialgaming_games", "Games on the game shards, by status.",
+                                       "status=\"" + std::string(STATUS_NAMES[status]) + "\"");
+    }
+}
+
+GameShard::GameShard(unsigned update_interval, ExecutionLimits limits, ShardMetrics& metrics)
+    : update_interval(update_interval), limits(limits), metrics(metrics) {
+}
+
+GameShard::~GameShard() {
+    stopping = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (auto& [gameID, game] : games) {
+        countGame(game, -1);
+    }
+}
+
+//////////////////////////////      NETWORK THREAD     //////////////////////////////
+
+void GameShard::post(ShardCommand command) {
+    unposted_commands.push_back(std::move(command));
+    while (!unposted_commands.empty() && inbox.push(std::move(unposted_commands.front()))) {
+        unposted_commands.pop_front();
+    }
+}
+
+void GameShard::collect(std::deque<Message>& outgoing, std::vector<uintptr_t>& finished_games) {
+    while (!unposted_commands.empty() && inbox.push(std::move(unposted_commands.front()))) {
+        unposted_commands.pop_front();
+    }
+
+    Message message;
+    while (outbox.pop(message)) {
+        outgoing.push_back(std::move(message));
+    }
+    uintptr_t gameID;
+    while (finished_outbox.pop(gameID)) {
+        finished_games.push_back(gameID);
+    }
+}
+
+void GameShard::start() {
+    worker = std::thread([this]() {
+        auto interval = std::chrono::milliseconds(update_interval);
+        auto next_tick = std::chrono::steady_clock::now();
+        while (!stopping) {
+            tick();
+            next_tick += interval;
+            std::this_thread::sleep_until(next_tick);
+        }
+    });
+}
+
+//////////////////////////////      SHARD THREAD     //////////////////////////////
+
+// the index typed as input, nothing if it is not a number or too large for an index
+std::optional<uint32_t> parseIndex(std::string_view s) {
+    uint32_t index = 0;
+    auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), index);
+    if (error != std::errc{} || end != s.data() + s.size()) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+void GameShard::tick() {
+    ScopedTimer timer{metrics.tick_duration};
+    current_tick++;
+
+    ShardCommand command;
+    while (inbox.pop(command)) {
+        handleCommand(command);
+    }
+    fireInputTimeouts();
+
+    auto deadline = ExecutionBudget::Clock::now() + limits.tick_time_budget;
+
+    // only the games that were ready at the start of the tick are visited, games that are
+    // still ready afterwards go to the back of the queue. Games left over when the deadline
+    // passes stay at the front so they are the first to run on the next tick
+    size_t num_ready = ready_games.size();
+    for (size_t i = 0; i < num_ready && ExecutionBudget::Clock::now() < deadline; i++) {
+        uintptr_t gameID = ready_games.front();
+        ready_games.pop_front();
+        ready_game_set.erase(gameID);
+
+        auto game = games.find(gameID);
+        if (game == games.end()) {
+            continue; // the game ended after it was queued
+        }
+
+        countGame(game->second, -1);
+        if (game->second.status() == GameStatus::Finished) {
+            finishGame(game->second);
+            games.erase(game);
+            continue;
+        }
+        if (processReadyGame(game->second, deadline)) {
+            markGameReady(gameID);
+        }
+        countGame(game->second, 1);
+    }
+
+    flushQueues();
+}
+
+void GameShard::handleCommand(ShardCommand& command) {
+    switch (command.type) {
+        case ShardCommand::StartGame: {
+            auto [game, inserted] = games.emplace(command.gameID, std::move(*command.game));
+            command.game.reset();
+            runGame(game->second, ExecutionBudget::Clock::now() + limits.tick_time_budget);
+            countGame(game->second, 1);
+            markGameReady(command.gameID);
+        }
+        break;
+        case ShardCommand::PlayerInput: {
+            GameInput& game_input = user_game_input[command.user];
+            game_input.input = std::move(command.input);
+            game_input.choice = command.choice;
+            game_input.new_input = true;
+            markGameReady(command.gameID);
+        }
+        break;
+        case ShardCommand::RemovePlayer: {
+            auto game = games.find(command.gameID);
+            if (game != games.end()) {
+                countGame(game->second, -1);
+                game->second.removePlayer(command.user);
+                countGame(game->second, 1);
+            }
+        }
+        break;
+        case ShardCommand::EndGame: {
+            auto game = games.find(command.gameID);
+            if (game != games.end()) {
+                countGame(game->second, -1);
+                games.erase(game);
+            }
+        }
+        break;
+    }
+}
+
+void GameShard::flushQueues() {
+    while (!unsent_messages.empty() && outbox.push(std::move(unsent_messages.front()))) {
+        unsent_messages.pop_front();
+    }
+    while (!unsent_finished.empty() && finished_outbox.push(std::move(unsent_finished.front()))) {
+        unsent_finished.pop_front();
+    }
+}
+
+void GameShard::send(Message message) {
+    unsent_messages.push_back(std::move(message));
+}
+
+bool GameShard::processReadyGame(Game& game, ExecutionBudget::Clock::time_point deadline) {
+    switch (game.status()) {
+        case GameStatus::AwaitingOutput: {
+            LOG(INFO) << "game " << game.id() << ": AwaitingOutput";
+            processGameMsgs(game);
+            game.outputSent(); // changes the status to AwaitingInput
+            // the game stays idle until input arrives or times out
+            return game.inputRequests().empty();
+        }
+        case GameStatus::AwaitingInput: {
+            LOG(INFO) << "game " << game.id() << ": AwaitingInput";
+            processGameInput(game);
+            if (!game.inputRequests().empty()) {
+                return false;
+            }
+            runGame(game, deadline);
+            return true; // output is pending, the game yielded or finished
+        }
+        case GameStatus::Running: {
+            LOG(INFO) << "game " << game.id() << ": Running";
+            runGame(game, deadline);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void GameShard::runGame(Game& game, ExecutionBudget::Clock::time_point deadline) {
+    ExecutionBudget budget(limits.steps_per_game, deadline);
+    game.run(budget);
+}
+
+void GameShard::finishGame(Game& game) {
+    LOG(INFO) << "game " << game.id() << ": GameFinished";
+    processGameMsgs(game);
+
+    // binary clients get the final scores along with the end of the game
+    std::string frames;
+    appendScoresEvent(frames, game.scores());
+    appendGameStateEvent(frames, GameStateChange::Finished, game.id());
+    Payload finished = makePayload(std::move(frames));
+
+    send({game.owner(), "\nThe game has finished!\nReturning to the lobby\n\n", nullptr,
+          Priority::Informational, finished});
+    for (auto player : game.players()) {
+        if (player == game.owner()) continue;
+        send({player, "\nGood game!\nYou are now back in the lobby\n\n", nullptr,
+              Priority::Informational, finished});
+    }
+    unsent_finished.push_back(game.id());
+}
+
+void GameShard::countGame(Game& game, int sign) {
+    metrics.games[game.status()]->add(sign);
+    metrics.pending_input_requests.add(sign * static_cast<int64_t>(game.inputRequests().size()));
+}
+
+void GameShard::markGameReady(uintptr_t gameID) {
+    if (ready_game_set.insert(gameID).second) {
+        ready_games.push_back(gameID);
+    }
+}
+
+void GameShard::fireInputTimeouts() {
+    while (!input_timeouts.empty() && input_timeouts.top().tick <= current_tick) {
+        InputTimeout timeout = input_timeouts.top();
+        input_timeouts.pop();
+
+        GameInput* game_input = user_game_input.find(timeout.user);
+        if (game_input != nullptr && game_input->timeout_tick == timeout.tick) {
+            markGameReady(timeout.gameID);
+        }
+    }
+}
+
+void GameShard::processGameInput(Game& game) {
+    // registering input removes the request, so i only advances past requests that are still pending
+    const std::deque<InputRequest>& input_requests = game.inputRequests();
+    for (size_t i = 0; i < input_requests.size();) {
+        const InputRequest& input_request = input_requests[i];
+        User user = input_request.user;
+        GameInput& game_input = user_game_input[user];
+
+        if (game_input.new_input) {
+            // check if valid input, a choice is compared as sent and typed input is parsed first
+            std::optional<uint32_t> index = game_input.choice ? game_input.choice : parseIndex(game_input.input);
+            if (input_request.type != InputType::Text &&
+                    (!index || *index >= input_request.num_choices)) {
+                std::stringstream msg;
+                msg << "Invalid index, please enter a number between 0 and " << input_request.num_choices-1 << "\n";
+                send({ user, msg.str() });
+                game_input.new_input = false;
+                i++;
+                continue;
+            }
+
+            // the game reads back the index it checked here
+            std::string input = game_input.choice || input_request.type != InputType::Text
+                ? std::to_string(*index)
+                : game_input.input;
+            game.registerPlayerInput(user, input);
+            send({
+                user,
+                "Input Received, you entered: " + input + "\n"
+                "Waiting for other players...\n\n"
+            });
+        } else if (input_request.has_timeout && game_input.timeout_tick <= current_tick) {
+            game.inputRequestTimedout(user);
+            send({
+                user,
+                "Input window timed out!\n"
+                "Selecting index 0\n\n"
+            });
+        } else {
+            i++;
+        }
+    }
+}
+
+void GameShard::processGameMsgs(Game& game) {
+    // add the global msg strings to the outgoing message list (main screen)
+    for (auto& global_msg_string : game.globalMsgs()) {
+        send({ game.owner(), std::move(global_msg_string) });
+    }
+
+    // add the player input request prompts to the outgoing message list (player screens)
+    const std::deque<InputRequest>& input_requests = game.inputRequests();
+    for (const auto& input_request : input_requests) {
+        std::string frames;
+        appendPromptEvent(frames, input_request);
+        send({ input_request.user, input_request.prompt, nullptr, Priority::Critical, makePayload(std::move(frames)) });
+    }
+
+    // flag the users requiring input (if the game is not finished) and schedule their timeouts
+    for (const auto& input_request: input_requests) {
+        GameInput& game_input = user_game_input[input_request.user];
+        game_input.new_input = false;
+        game_input.timeout_tick = 0;
+        if (input_request.has_timeout) {
+            uint64_t ticks = std::max<uint64_t>(1, (input_request.timeout_ms + update_interval - 1) / update_interval);
+            game_input.timeout_tick = current_tick + ticks;
+            input_timeouts.push({ game_input.timeout_tick, game.id(), input_request.user });
+        }
+    }
+}
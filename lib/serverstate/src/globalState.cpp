@@ -1,154 +1,260 @@
 #include "globalState.h"
+#include "gameEvents.h"
+
+GlobalServerState::GlobalServerState(unsigned update_interval, ExecutionLimits limits, unsigned worker_threads,
+                                     LobbyLimits lobby_limits, Metrics* metrics)
+    : owned_metrics(metrics == nullptr ? std::make_unique<Metrics>() : nullptr),
+      metrics_registry(metrics == nullptr ? *owned_metrics : *metrics),
+      shard_metrics(metrics_registry),
+      hosted_games(metrics_registry.gauge("socialgaming_hosted_games",
+          "Games hosted by the server, waiting in their lobby or running.")),
+      threaded(worker_threads > 0), lobby(lobby_limits) {
+    populateGameList();
+
+    size_t num_shards = std::max(1u, worker_threads);
+    for (size_t i = 0; i < num_shards; i++) {
+        shards.push_back(std::make_unique<GameShard>(update_interval, limits, shard_metrics));
+        if (threaded) {
+            shards.back()->start();
+        }
+    }
+}
+
+const GlobalServerState::Session* GlobalServerState::getSession(User user) {
+    return sessions.find(user);
+}
 
 void GlobalServerState::addNewUsers(std::vector<User>& users) {
-    clients.insert(clients.end(), users.begin(), users.end());
-    // clients_in_lobby.insert(clients_in_lobby.end(), users.begin(), users.end());
+    for (auto user : users) {
+        sessions[user] = Session{};
+    }
     users.clear();
 }
 
 void GlobalServerState::disconnectUser(User user) {
-    removeClientFromList(clients, user);
-    removeClientFromList(clients_in_lobby, user);
+    sessions.erase(user);
+    lobby.forget(user);
+    matchmaker.remove(user);
+}
+
+void GlobalServerState::disconnectUsers(const std::vector<User>& users, std::deque<Message>& outgoing) {
+    // the games losing users, the names of their lost players are collected before the sessions go
+    std::vector<uintptr_t> owner_lost;
+    std::unordered_map<uintptr_t, std::vector<std::string>> players_lost;
+    for (auto user : users) {
+        const Session* session = sessions.find(user);
+        if (session == nullptr || session->location != Session::InGame) {
+            continue;
+        }
+        if (session->owner) {
+            owner_lost.push_back(session->game);
+        } else {
+            players_lost[session->game].push_back(session->name);
+        }
+    }
+
+    for (auto user : users) {
+        sessions.erase(user);
+        matchmaker.remove(user);
+    }
+    lobby.forgetAll(users);
+
+    // from here on the lost users have no session, which tells them apart from the players that remain
+    auto isConnected = [this](User player) { return sessions.contains(player); };
+
+    Payload owner_left = makePayload("\nOwner left the server. Game Ended!\n\n");
+    for (uintptr_t gameID : owner_lost) {
+        Payload ended = gameStateEvent(GameStateChange::Ended, gameID);
+        for (auto player : getGameInstancebyId(gameID)->players) {
+            if (isConnected(player)) {
+                outgoing.push_back({player, {}, owner_left, Priority::Informational, ended});
+            }
+        }
+        players_lost.erase(gameID);
+        endGameInstance(gameID);
+    }
+
+    for (auto& [gameID, names] : players_lost) {
+        GameInfo* game_instance = getGameInstancebyId(gameID);
+        auto lost = std::stable_partition(game_instance->players.begin(), game_instance->players.end(), isConnected);
+        for (auto player = lost; player != game_instance->players.end(); player++) {
+            if (game_instance->started()) {
+                shards[game_instance->shard]->post({ShardCommand::RemovePlayer, gameID, *player});
+            } else {
+                game_instance->game->removePlayer(*player);
+            }
+        }
+        game_instance->players.erase(lost, game_instance->players.end());
+
+        if (game_instance->started() && game_instance->players.size() < game_instance->min_players) {
+            Payload not_enough = makePayload("\nNot enough players left, ending game.\n\n");
+            for (auto player : game_instance->players) {
+                outgoing.push_back({player, {}, not_enough});
+            }
+            outgoing.push_back({game_instance->owner, {}, not_enough});
+            endGameInstance(gameID);
+            continue;
+        }
+
+        std::stringstream notification;
+        notification << "\n";
+        for (size_t i = 0; i < names.size(); i++) {
+            notification << (i ? ", " : "") << names[i];
+        }
+        notification << " left\n\n";
+        Payload left = makePayload(notification.str());
+        for (auto player : game_instance->players) {
+            outgoing.push_back({player, {}, left});
+        }
+        notification << "Player Count : " << game_instance->players.size() << "\n\n";
+        outgoing.push_back({game_instance->owner, notification.str()});
+    }
 }
 
 void GlobalServerState::addClientToGame(User user, uintptr_t invitationCode) {
-    Game *game_instance = getGameInstancebyInvitation(invitationCode);
+    GameInfo *game_instance = getGameInstancebyInvitation(invitationCode);
 
-    game_instance->addPlayer(user, getName(user));
+    if (game_instance->game->addPlayer(user, getName(user))) {
+        game_instance->players.push_back(user);
+    }
 
-    clients_in_games[user] = game_instance->id();
-    removeClientFromList(clients_in_lobby, user);
+    Session& session = sessions[user];
+    session.location = Session::InGame;
+    session.game = game_instance->id;
+    lobby.leave(user);
+    matchmaker.remove(user);
 }
 
 void GlobalServerState::addClientToLobby(User user) {
-    clients_in_lobby.push_back(user);
+    sessions[user].location = Session::InLobby;
+    lobby.rejoin(user);
+}
+
+bool GlobalServerState::joinRoom(User user, std::string_view room) {
+    return lobby.join(user, room);
 }
 
 void GlobalServerState::removeClientFromGame(User user) {
-    uintptr_t gameID = clients_in_games[user];
-    Game *game_instance = getGameInstancebyId(gameID);
+    uintptr_t gameID = sessions[user].game;
+    GameInfo *game_instance = getGameInstancebyId(gameID);
 
-    game_instance->removePlayer(user);
-    clients_in_games.erase(user);
-    clients_in_lobby.push_back(user);
+    if (game_instance->started()) {
+        shards[game_instance->shard]->post({ShardCommand::RemovePlayer, gameID, user});
+    } else {
+        game_instance->game->removePlayer(user);
+    }
+    removeClientFromList(game_instance->players, user);
+    returnToLobby(user);
 }
 
 ///////////////////     GAME-RELATED FUNCTIONS     ///////////////////
 
-void GlobalServerState::constructGame(std::vector<Game>& game_instances, std::string game_name, User owner) {    
+bool GlobalServerState::registerCompiledGame(const std::string& path) {
+    auto compiledGame = CompiledGame::load(path);
+    if (!compiledGame) {
+        return false;
+    }
+    LOG(INFO) << "Using compiled game " << compiledGame->configName();
+    compiledGames[compiledGame->configName()] = std::move(compiledGame);
+    return true;
+}
+
+Game GlobalServerState::constructGame(std::string game_name, User owner) {
+    auto compiledGame = compiledGames.find(game_name);
+    if (compiledGame != compiledGames.end()) {
+        return compiledGame->second->instantiate(owner);
+    }
+
     //Interpreter maps json info into game object and then returns the game 
-    InterpretJson interpreter(game_name, owner);
-    game_instances.emplace_back(interpreter.interpret());
+    std::unique_ptr<InterpretJson>& interpreter = gameTemplates[game_name];
+    if (!interpreter) {
+        interpreter = std::make_unique<InterpretJson>(game_name, owner);
+    }
+    interpreter->owner = owner;
+    return interpreter->interpret();
+}
+
+Game::PlayerCount GlobalServerState::playerCountOf(const std::string& game_name) {
+    auto found = playerCounts.find(game_name);
+    if (found == playerCounts.end()) {
+        found = playerCounts.emplace(game_name, constructGame(game_name, User{0})._player_count).first;
+    }
+    return found->second;
 }
 
 uintptr_t GlobalServerState::createGame(int gameIndex, User user) {
-    
-    constructGame(game_instances, gameNameList[gameIndex], user);
+    auto game = std::make_unique<Game>(constructGame(gameNameList[gameIndex], user));
+    uintptr_t gameID = game->id();
+    unsigned min_players = game->_player_count.min;
+    game_instances.emplace(gameID, GameInfo{gameID, user, {}, min_players, std::move(game)});
 
-    removeClientFromList(clients_in_lobby, user);
-    clients_in_games[user] = game_instances.back().id();
-    gameOwnerMap[user] = game_instances.back().id();
+    lobby.leave(user);
+    matchmaker.remove(user);
+    Session& session = sessions[user];
+    session.location = Session::InGame;
+    session.game = gameID;
+    session.owner = true;
 
-    return game_instances.back().id();
+    return gameID;
 }
 
 void GlobalServerState::startGame(User user) {
-    Game *game_instance = getGameInstancebyUser(user);
-    game_instance->run();
+    GameInfo *game_instance = getGameInstancebyUser(user);
+    game_instance->shard = game_instance->id % shards.size();
+    shards[game_instance->shard]->post({ShardCommand::StartGame, game_instance->id, user, "", std::move(game_instance->game)});
 }
 
 void GlobalServerState::endGame(User user) {
-    Game *game_instance = getGameInstancebyUser(user);
-    // FIX: Figure if needed here (related to createGame) (right now owner is added to clients in games)
-    clients_in_games.erase(user);
-    clients_in_lobby.push_back(user);
-
-    // remove players
-    for (auto &player : game_instance->players()) {
-        clients_in_lobby.push_back(player);
-        clients_in_games.erase(player);
-    }
+    endGameInstance(getGameInstancebyUser(user)->id);
+}
 
-    gameOwnerMap.erase(user);
-    removeGameInstance(game_instance->id());
+void GlobalServerState::queueForGame(User user, int gameIndex) {
+    matchmaker.enqueue(user, gameIndex);
 }
 
-bool is_number(std::string_view s) {
-    return !s.empty() && std::find_if(s.begin(), s.end(), 
-        [](unsigned char c) { return !std::isdigit(c); }) == s.end();
+void GlobalServerState::formQueuedGames(std::deque<Message>& outgoing) {
+    std::vector<Match> matches = matchmaker.formMatches(
+        [this](int gameIndex) { return playerCountOf(gameNameList[gameIndex]); });
+
+    for (auto& match : matches) {
+        uintptr_t gameID = createGame(match.game_index, match.host);
+        for (User player : match.players) {
+            addClientToGame(player, gameID);
+        }
+
+        std::stringstream notification;
+        notification << "\nMatch found! You are hosting " << gameNameList[match.game_index]
+                     << " with " << match.players.size() << " players\n\n";
+        outgoing.push_back({match.host, notification.str()});
+        Payload started = makePayload("\nMatch found! Game Started!\n\n");
+        Payload event = gameStateEvent(GameStateChange::Started, gameID);
+        for (User player : match.players) {
+            outgoing.push_back({player, {}, started, Priority::Informational, event});
+        }
+
+        startGame(match.host);
+    }
 }
 
 std::deque<Message> GlobalServerState::processGames() {
     std::deque<Message> outgoing;
+    formQueuedGames(outgoing);
 
-    auto game = game_instances.begin();
-    while (game != game_instances.end()) {
-        // LOG(INFO) << "Game Check";
-        switch (game->status()) {
-            case GameStatus::AwaitingOutput: {
-                LOG(INFO) << "game " << game->id() << ": AwaitingOutput";
-                processGameMsgs(*game, outgoing);
-                game->outputSent(); // changes the status to AwaitingInput
-                game++;
-            }
-            break;
-            case GameStatus::AwaitingInput: {
-                LOG(INFO) << "game " << game->id() << ": AwaitingInput";
-                std::deque<InputRequest> input_requests = game->inputRequests();
-                for (auto input_request: input_requests) {
-                    User user = input_request.user;
-                    if (user_game_input[user].new_input) {
-                        std::string input = user_game_input[user].input;
-
-                        // check if valid input
-                        if (input_request.type != InputType::Text &&  
-                                (!is_number(input) || (unsigned)std::stoi(input) >= input_request.num_choices)) {
-                            std::stringstream msg;
-                            msg << "Invalid index, please enter a number between 0 and " << input_request.num_choices-1 << "\n";
-                            outgoing.push_back({ user, msg.str() });
-                            user_game_input[user].new_input = false;
-                            continue;
-                        }
-
-                        game->registerPlayerInput(user, input);
-                        outgoing.push_back({
-                            user,
-                            "Input Received, you entered: " + input + "\n"
-                            "Waiting for other players...\n\n"
-                        });
-                    } else if (input_request.has_timeout) {
-                        user_game_input[user].time_remaining -= update_interval;
-                        if (user_game_input[user].time_remaining <= 0) {
-                            game->inputRequestTimedout(user);
-                            outgoing.push_back({
-                                user,
-                                "Input window timed out!\n"
-                                "Selecting index 0\n\n"
-                            });
-                        }
-                    }
-                }
-
-                if (game->inputRequests().size() == 0) {
-                    game->run();
-                }
-                game++;
-            }
-            break;
-            case GameStatus::Finished: {
-                LOG(INFO) << "game " << game->id() << ": GameFinished";
-                processGameMsgs(*game, outgoing);
-                outgoing.push_back({game->owner(), "\nThe game has finished!\nReturning to the lobby\n\n"});
-                std::deque<Message> finalMsgs = buildMsgsForOtherPlayers("\nGood game!\nYou are now back in the lobby\n\n", game->owner());
-                outgoing.insert(outgoing.end(), finalMsgs.begin(), finalMsgs.end());
-                endGame(game->owner());
-            }
-            break;
-            default:
-                game++;
-            break;
+    std::vector<uintptr_t> finished_games;
+    for (auto& shard : shards) {
+        if (!threaded) {
+            shard->tick();
         }
+        shard->collect(outgoing, finished_games);
     }
+
+    // the game may have been ended by its owner while it finished
+    for (uintptr_t gameID : finished_games) {
+        if (getGameInstancebyId(gameID) != nullptr) {
+            removeGameInstance(gameID);
+        }
+    }
+    hosted_games.set(game_instances.size());
     return outgoing;
 }
 
@@ -167,31 +273,53 @@ GlobalServerState::getGameNamesAsString() {
 
 User
 GlobalServerState::getGameOwner(User user){
-    return getGameInstancebyUser(user)->owner();
+    return getGameInstancebyUser(user)->owner;
+}
+
+uintptr_t GlobalServerState::getGameID(User user) {
+    return getGameInstancebyUser(user)->id;
 }
 
 int GlobalServerState::getPlayerCount(User user) {
-    uintptr_t gameID = clients_in_games[user];
-    return getGameInstancebyId(gameID)->numPlayers();
+    return getGameInstancebyUser(user)->players.size();
 }
 
 void GlobalServerState::setName(User user, std::string name) {
-    userNames[user] = name;
+    sessions[user].name = std::move(name);
 }
 
 std::string GlobalServerState::getName(User user) {
-    if(userNames.find(user) != userNames.end()) {
-        return userNames[user];
+    const Session* session = sessions.find(user);
+    if (session != nullptr && !session->name.empty()) {
+        return session->name;
     }
     return "error";
 }
 
+std::string GlobalServerState::getRoomName(User user) {
+    return lobby.roomName(user);
+}
+
+std::string GlobalServerState::getRoomsAsString() {
+    return lobby.roomsAsString();
+}
+
 bool GlobalServerState::isInLobby(User user){
-    return std::find(clients_in_lobby.begin(), clients_in_lobby.end(), user) != clients_in_lobby.end();
+    const Session* session = sessions.find(user);
+    return session != nullptr && session->location == Session::InLobby;
 }
 
 bool GlobalServerState::isInGame(User user) {
-    return clients_in_games.find(user) != clients_in_games.end();
+    const Session* session = sessions.find(user);
+    return session != nullptr && session->location == Session::InGame;
+}
+
+std::string GlobalServerState::getGameName(int index) {
+    return gameNameList[index];
+}
+
+size_t GlobalServerState::getQueueLength(int gameIndex) {
+    return matchmaker.queueLength(gameIndex);
 }
 
 bool GlobalServerState::isGameIndex(int index) {
@@ -199,107 +327,124 @@ bool GlobalServerState::isGameIndex(int index) {
 }
 
 bool GlobalServerState::isOwner(User user) {
-    return gameOwnerMap.find(user) != gameOwnerMap.end();
+    const Session* session = sessions.find(user);
+    return session != nullptr && session->owner;
 }
 
 bool GlobalServerState::gameHasEnoughPlayers(User user) {
-    return getGameInstancebyUser(user)->hasEnoughPlayers();
+    GameInfo *game_instance = getGameInstancebyUser(user);
+    return game_instance->players.size() >= game_instance->min_players;
 }
 
+// a game is ongoing from the moment it is started until its shard reports it finished
 bool GlobalServerState::isOngoingGame(User user) {
-    Game *game_instance = getGameInstancebyUser(user);
-    return game_instance->status() != GameStatus::Finished
-        && game_instance->status() != GameStatus::Created;
+    return getGameInstancebyUser(user)->started();
 }
 
 bool GlobalServerState::isOngoingGame(uintptr_t invitation_code) {
-    Game *game_instance = getGameInstancebyInvitation(invitation_code);
-    return game_instance->status() != GameStatus::Finished
-        && game_instance->status() != GameStatus::Created;
+    return getGameInstancebyInvitation(invitation_code)->started();
 }
 
 bool GlobalServerState::isValidGameInvitation(uintptr_t invitation_code) {
-    Game *game_instance = getGameInstancebyInvitation(invitation_code);
+    GameInfo *game_instance = getGameInstancebyInvitation(invitation_code);
     return game_instance != nullptr;
 }
 
 void GlobalServerState::registerUserGameInput(User user, std::string input) {
-    user_game_input[user].input = input;
-    user_game_input[user].new_input = true;
+    GameInfo *game_instance = getGameInstancebyUser(user);
+    // input sent before the game starts is dropped, as the game has not asked for any
+    if (game_instance != nullptr && game_instance->started()) {
+        shards[game_instance->shard]->post({ShardCommand::PlayerInput, game_instance->id, user, std::move(input)});
+    }
+}
+
+void GlobalServerState::registerUserGameInput(User user, uint32_t choice) {
+    GameInfo *game_instance = getGameInstancebyUser(user);
+    if (game_instance != nullptr && game_instance->started()) {
+        shards[game_instance->shard]->post({ShardCommand::PlayerInput, game_instance->id, user, "", nullptr, choice});
+    }
 }
 
 //////////////////////////////      BROADCASTING MESSAGE BUILDERS   //////////////////////
 
-std::deque<Message>
-GlobalServerState::buildMessagesForServerLobby(std::string messageText) {
-    std::deque<Message> messages;
-    for (auto client : clients_in_lobby) {
-        messages.push_back({client, messageText});
-    }
-    return messages;
+void
+GlobalServerState::buildMessagesForServerLobby(const std::string& messageText, std::deque<Message>& outgoing) {
+    lobby.broadcast(makePayload(messageText), outgoing);
+}
+
+void GlobalServerState::publishLobbyMessage(User user, std::string_view text) {
+    lobby.publish(user, getName(user), text);
 }
 
-std::deque<Message>
-GlobalServerState::buildMsgsForOtherPlayers(std::string messageText, User user) {
-    std::deque<Message> messages;
-    Game* game = getGameInstancebyUser(user);
+void GlobalServerState::buildLobbyDigest(std::deque<Message>& outgoing) {
+    lobby.buildDigests(outgoing);
+}
+
+void
+GlobalServerState::buildMsgsForOtherPlayers(const std::string& messageText, User user, std::deque<Message>& outgoing,
+                                            Payload event) {
+    GameInfo* game = getGameInstancebyUser(user);
 
-    for (auto player : game->players()) {
+    Payload payload = makePayload(messageText);
+    for (auto player : game->players) {
         if (player == user) continue;
-        messages.push_back({player, messageText});
+        outgoing.push_back({player, {}, payload, Priority::Informational, event});
     }
-    return messages;
 }
 
-std::deque<Message>
-GlobalServerState::buildMsgsForAllPlayers(std::string messageText, User user) {
-    std::deque<Message> messages;
-    Game* game = getGameInstancebyUser(user);
+void
+GlobalServerState::buildMsgsForAllPlayers(const std::string& messageText, User user, std::deque<Message>& outgoing) {
+    GameInfo* game = getGameInstancebyUser(user);
 
-    for (auto player : game->players()) {
-        messages.push_back({player, messageText});
+    Payload payload = makePayload(messageText);
+    for (auto player : game->players) {
+        outgoing.push_back({player, {}, payload});
     }
-    return messages;
 }
 
-std::deque<Message>
-GlobalServerState::buildMsgsForAllPlayersAndOwner(std::string messageText, User user) {
-    std::deque<Message> messages = buildMsgsForAllPlayers(messageText, user);
-    Game* game = getGameInstancebyUser(user);
-    messages.push_back({game->owner(), messageText});
-    return messages;
+void
+GlobalServerState::buildMsgsForAllPlayersAndOwner(const std::string& messageText, User user, std::deque<Message>& outgoing,
+                                                  Payload event) {
+    GameInfo* game = getGameInstancebyUser(user);
+
+    Payload payload = makePayload(messageText);
+    for (auto player : game->players) {
+        outgoing.push_back({player, {}, payload, Priority::Informational, event});
+    }
+    outgoing.push_back({game->owner, {}, payload, Priority::Informational, event});
 }
 
 //////////////////////////////      PRIVATE METHODS     /////////////////////////////////
 
-void GlobalServerState::processGameMsgs(Game& game, std::deque<Message>& outgoing) {
-    // add the global msg strings to the outgoing message list (main screen)
-    std::deque<std::string> global_msg_strings = game.globalMsgs();
-    std::transform(global_msg_strings.begin(), global_msg_strings.end(), std::back_inserter(outgoing),
-        [&game](auto global_msg_string) {
-            return Message{ game.owner(), global_msg_string };
-        }
-    );
-
-    // add the player input request prompts to the outgoing message list (player screens)
-    std::deque<InputRequest> input_requests = game.inputRequests();
-    std::transform(input_requests.begin(), input_requests.end(), std::back_inserter(outgoing),
-        [](auto input_request) {
-            return Message{ input_request.user, input_request.prompt };
-        }
-    );
+void GlobalServerState::removeGameInstance(uintptr_t gameID) {
+    GameInfo& game_instance = game_instances.at(gameID);
+    returnToLobby(game_instance.owner);
 
-    // flag the users requiring input (if the game is not finished)
-    for (auto input_request: input_requests) {
-        user_game_input[input_request.user].new_input = false;
-        user_game_input[input_request.user].time_remaining = input_request.timeout_ms;
+    // remove players
+    for (auto &player : game_instance.players) {
+        returnToLobby(player);
     }
+
+    game_instances.erase(gameID);
 }
 
-void GlobalServerState::removeGameInstance(uintptr_t gameID) {
-    auto eraseEnd = std::remove_if(game_instances.begin(), game_instances.end(), [gameID](auto &game) { return game.id() == gameID; });
+void GlobalServerState::endGameInstance(uintptr_t gameID) {
+    GameInfo *game_instance = getGameInstancebyId(gameID);
+    if (game_instance->started()) {
+        shards[game_instance->shard]->post({ShardCommand::EndGame, gameID});
+    }
+    removeGameInstance(gameID);
+}
 
-    game_instances.erase(eraseEnd, game_instances.end());
+void GlobalServerState::returnToLobby(User user) {
+    Session* session = sessions.find(user);
+    if (session == nullptr) {
+        return; // disconnected
+    }
+    session->location = Session::InLobby;
+    session->game = 0;
+    session->owner = false;
+    lobby.rejoin(user);
 }
 
 void GlobalServerState::removeClientFromList(std::vector<User> &list, User user) {
@@ -307,36 +452,24 @@ void GlobalServerState::removeClientFromList(std::vector<User> &list, User user)
     list.erase(eraseBegin, list.end());
 }
 
-Game *
+GlobalServerState::GameInfo *
 GlobalServerState::getGameInstancebyUser(User user) {
-    uintptr_t gameID = clients_in_games[user];
-    return getGameInstancebyId(gameID);
-}
-
-Game *
-GlobalServerState::getGameInstancebyOwner(User user) {
-    // WARNING: Assumes, owner exists;
-    uintptr_t gameID = gameOwnerMap[user];
-
-    auto findGamePredicate = [gameID](auto &game) { return game.id() == gameID; };
-    auto game_iterator = std::find_if(game_instances.begin(), game_instances.end(), findGamePredicate);
-    return &(*game_iterator);
+    const Session* session = sessions.find(user);
+    if (session == nullptr || session->location != Session::InGame) {
+        return nullptr;
+    }
+    return getGameInstancebyId(session->game);
 }
 
-Game *
+GlobalServerState::GameInfo *
 GlobalServerState::getGameInstancebyInvitation(uintptr_t invitationCode) {
-    auto findGamePredicate = [invitationCode](auto &game) { return game.id() == invitationCode; };
-    auto game_iterator = std::find_if(game_instances.begin(), game_instances.end(), findGamePredicate);
-
-    return game_iterator == game_instances.end() ? nullptr : &(*game_iterator);
+    return getGameInstancebyId(invitationCode);
 }
 
-Game *
+GlobalServerState::GameInfo *
 GlobalServerState::getGameInstancebyId(uintptr_t gameID) {
-    auto findGamePredicate = [gameID](auto &game) { return game.id() == gameID; };
-    auto game_iterator = std::find_if(game_instances.begin(), game_instances.end(), findGamePredicate);
-
-    return game_iterator == game_instances.end() ? nullptr : &(*game_iterator);
+    auto game_iterator = game_instances.find(gameID);
+    return game_iterator == game_instances.end() ? nullptr : &game_iterator->second;
 }
 
 // compiles all the game names in ./gameconfigs into a list
@@ -0,0 +1,29 @@
+#include "lobbyChat.h"
+
+LobbyChat::LobbyChat(size_t max_lines)
+    : max_lines(max_lines) {
+}
+
+void LobbyChat::publish(std::string_view name, std::string_view text) {
+    if (num_lines == max_lines) {
+        num_dropped++;
+        return;
+    }
+    digest.append(name).append(" : ").append(text).append("\n");
+    num_lines++;
+}
+
+Payload LobbyChat::takeDigest() {
+    if (num_lines == 0 && num_dropped == 0) {
+        return nullptr;
+    }
+    if (num_dropped > 0) {
+        digest.append("(").append(std::to_string(num_dropped)).append(" more lobby messages were dropped)\n");
+    }
+
+    Payload payload = makePayload(std::move(digest));
+    digest.clear();
+    num_lines = 0;
+    num_dropped = 0;
+    return payload;
+}
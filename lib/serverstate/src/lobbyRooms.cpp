@@ -0,0 +1,173 @@
+#include "lobbyRooms.h"
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+LobbyRooms::LobbyRooms(LobbyLimits limits)
+    : limits(limits) {
+}
+
+bool LobbyRooms::join(User user, std::string_view room) {
+    if (room.empty() || limits.max_room_name < room.size()) {
+        return false;
+    }
+    leave(user);
+
+    std::string& user_room_name = user_room[user];
+    user_room_name = room;
+    size_t shard = findShard(user_room_name);
+    shards[shard].members.push_back(user);
+    user_shard[user] = shard;
+    return true;
+}
+
+void LobbyRooms::rejoin(User user) {
+    const std::string* room = user_room.find(user);
+    join(user, room != nullptr ? std::string(*room) : std::string(MAIN_ROOM));
+}
+
+void LobbyRooms::leave(User user) {
+    size_t* shard = user_shard.find(user);
+    if (shard == nullptr) {
+        return;
+    }
+    size_t left_shard = *shard;
+    std::vector<User>& members = shards[left_shard].members;
+    members.erase(std::find(members.begin(), members.end(), user));
+    user_shard.erase(user);
+    removeIfEmpty(left_shard);
+}
+
+void LobbyRooms::forget(User user) {
+    leave(user);
+    user_room.erase(user);
+}
+
+void LobbyRooms::forgetAll(const std::vector<User>& users) {
+    std::vector<size_t> swept_shards;
+    for (auto user : users) {
+        size_t* shard = user_shard.find(user);
+        if (shard != nullptr) {
+            swept_shards.push_back(*shard);
+            user_shard.erase(user);
+        }
+        user_room.erase(user);
+    }
+
+    // highest first, so that removing a shard does not move the ones still to sweep
+    std::sort(swept_shards.begin(), swept_shards.end(), std::greater<size_t>());
+    swept_shards.erase(std::unique(swept_shards.begin(), swept_shards.end()), swept_shards.end());
+    for (size_t shard : swept_shards) {
+        std::vector<User>& members = shards[shard].members;
+        members.erase(std::remove_if(members.begin(), members.end(),
+            [this](User member) { return !user_shard.contains(member); }), members.end());
+        removeIfEmpty(shard);
+    }
+}
+
+bool LobbyRooms::contains(User user) const {
+    return user_shard.contains(user);
+}
+
+std::string LobbyRooms::roomName(User user) const {
+    const std::string* room = user_room.find(user);
+    if (room == nullptr) {
+        return std::string(MAIN_ROOM);
+    }
+    const size_t* shard = user_shard.find(user);
+    if (shard == nullptr || room_shards.at(*room).size() == 1) {
+        return *room;
+    }
+    return *room + " #" + std::to_string(shards[*shard].number + 1);
+}
+
+std::string LobbyRooms::roomsAsString() const {
+    std::vector<std::pair<std::string, size_t>> rooms;
+    for (auto& [room, indices] : room_shards) {
+        size_t num_users = 0;
+        for (size_t shard : indices) {
+            num_users += shards[shard].members.size();
+        }
+        rooms.emplace_back(room, num_users);
+    }
+    std::sort(rooms.begin(), rooms.end());
+
+    std::stringstream text;
+    text << "\nRooms:\n";
+    for (auto& [room, num_users] : rooms) {
+        text << "  " << room << " (" << num_users << " users)\n";
+    }
+    text << "\n";
+    return text.str();
+}
+
+void LobbyRooms::publish(User user, std::string_view name, std::string_view text) {
+    size_t* shard = user_shard.find(user);
+    if (shard != nullptr) {
+        shards[*shard].chat.publish(name, text);
+    }
+}
+
+void LobbyRooms::buildDigests(std::deque<Message>& outgoing) {
+    for (auto& shard : shards) {
+        Payload digest = shard.chat.takeDigest();
+        if (!digest) {
+            continue;
+        }
+        for (auto member : shard.members) {
+            outgoing.push_back({member, {}, digest, Priority::Chat});
+        }
+    }
+}
+
+void LobbyRooms::broadcast(const Payload& payload, std::deque<Message>& outgoing) const {
+    for (auto& shard : shards) {
+        for (auto member : shard.members) {
+            outgoing.push_back({member, {}, payload});
+        }
+    }
+}
+
+size_t LobbyRooms::findShard(const std::string& room) {
+    std::vector<size_t>& indices = room_shards[room];
+    for (size_t shard : indices) {
+        if (shards[shard].members.size() < limits.shard_capacity) {
+            return shard;
+        }
+    }
+    // every shard of the room is full, the room overflows into a new shard
+    // numbered with the lowest number a removed shard left free
+    size_t number = 0;
+    while (std::any_of(indices.begin(), indices.end(),
+                       [this, number](size_t shard) { return shards[shard].number == number; })) {
+        number++;
+    }
+    shards.push_back({room, number, {}, LobbyChat{limits.digest_lines}});
+    indices.push_back(shards.size() - 1);
+    return indices.back();
+}
+
+void LobbyRooms::removeIfEmpty(size_t shard) {
+    if (!shards[shard].members.empty()) {
+        return;
+    }
+    auto room = room_shards.find(shards[shard].room);
+    std::vector<size_t>& indices = room->second;
+    indices.erase(std::find(indices.begin(), indices.end(), shard));
+    if (indices.empty()) {
+        room_shards.erase(room);
+    }
+
+    // the last shard moves into the freed index
+    size_t last = shards.size() - 1;
+    if (shard != last) {
+        std::vector<size_t>& last_indices = room_shards.at(shards[last].room);
+        *std::find(last_indices.begin(), last_indices.end(), last) = shard;
+        for (auto member : shards[last].members) {
+            user_shard[member] = shard;
+        }
+        shards[shard] = std::move(shards[last]);
+    }
+    shards.pop_back();
+}
@@ -0,0 +1,65 @@
+#include "matchmaker.h"
+
+#include <algorithm>
+
+void Matchmaker::enqueue(User user, int game_index) {
+    Queued* found = queued.find(user);
+    if (found != nullptr && found->game_index == game_index) {
+        return; // keeps their place in the queue
+    }
+    uint64_t ticket = next_ticket++;
+    queued[user] = {game_index, ticket};
+    queues[game_index].push_back({user, ticket});
+}
+
+bool Matchmaker::remove(User user) {
+    return queued.erase(user);
+}
+
+bool Matchmaker::isQueued(User user) const {
+    return queued.contains(user);
+}
+
+size_t Matchmaker::queueLength(int game_index) const {
+    auto queue = queues.find(game_index);
+    if (queue == queues.end()) {
+        return 0;
+    }
+    return std::count_if(queue->second.begin(), queue->second.end(),
+        [this, game_index](const Ticket& ticket) { return isValid(ticket, game_index); });
+}
+
+bool Matchmaker::isValid(const Ticket& ticket, int game_index) const {
+    const Queued* found = queued.find(ticket.user);
+    return found != nullptr && found->game_index == game_index && found->ticket == ticket.number;
+}
+
+std::vector<Match> Matchmaker::formMatches(const PlayerCountLookup& player_count) {
+    std::vector<Match> matches;
+    for (auto& [game_index, queue] : queues) {
+        // drop the tickets of users that left the queue or queued for another game
+        queue.erase(std::remove_if(queue.begin(), queue.end(),
+            [this, game_index = game_index](const Ticket& ticket) { return !isValid(ticket, game_index); }),
+            queue.end());
+        if (queue.size() < 2) {
+            continue;
+        }
+
+        Game::PlayerCount count = player_count(game_index);
+        unsigned min_players = std::max(1u, count.min);
+        unsigned max_players = std::max(min_players, count.max);
+        while (queue.size() >= 1 + min_players) {
+            size_t num_players = std::min<size_t>(max_players, queue.size() - 1);
+            Match match{game_index, queue.front().user, {}};
+            queued.erase(match.host);
+            queue.pop_front();
+            for (size_t i = 0; i < num_players; i++) {
+                match.players.push_back(queue.front().user);
+                queued.erase(queue.front().user);
+                queue.pop_front();
+            }
+            matches.push_back(std::move(match));
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "InterpretJson.h"
+#include "compiledGame.h"
+#include "game.h"
+
+// The compiled Rock_Paper_Scissors must behave exactly like the interpreted one
+class CompiledGameTest : public ::testing::Test{
+protected:
+    void SetUp() override{
+        owner.id = 100;
+        compiledGame = CompiledGame::load(PATH_TO_COMPILED_GAME);
+        ASSERT_NE(compiledGame, nullptr);
+
+        InterpretJson j("Rock_Paper_Scissors", owner);
+        interpreted = j.interpret();
+        compiled = compiledGame->instantiate(owner);
+
+        User c1;
+        User c2;
+        c1.id = 1;
+        c2.id = 2;
+        for (Game* game : {&interpreted, &compiled}) {
+            game->addPlayer(c1, "1");
+            game->addPlayer(c2, "2");
+        }
+    }
+
+    // runs both games until they need input and checks that they produced the same output
+    void expectSameOutput() {
+        EXPECT_EQ(interpreted.status(), compiled.status());
+        EXPECT_EQ(interpreted.globalMsgs(), compiled.globalMsgs());
+
+        auto interpretedRequests = interpreted.inputRequests();
+        auto compiledRequests = compiled.inputRequests();
+        ASSERT_EQ(interpretedRequests.size(), compiledRequests.size());
+        for (size_t i = 0; i < interpretedRequests.size(); i++) {
+            EXPECT_EQ(interpretedRequests[i].user, compiledRequests[i].user);
+            EXPECT_EQ(interpretedRequests[i].prompt, compiledRequests[i].prompt);
+            EXPECT_EQ(interpretedRequests[i].num_choices, compiledRequests[i].num_choices);
+        }
+    }
+
+    User owner;
+    std::unique_ptr<CompiledGame> compiledGame;
+    Game interpreted;
+    Game compiled;
+};
+
+TEST_F(CompiledGameTest, SameConfiguration){
+    EXPECT_EQ(compiledGame->configName(), "Rock_Paper_Scissors");
+    EXPECT_EQ(interpreted.name(), compiled.name());
+    EXPECT_EQ(interpreted.owner(), compiled.owner());
+    EXPECT_EQ(interpreted.audience(), compiled.audience());
+    EXPECT_EQ(interpreted._player_count.min, compiled._player_count.min);
+    EXPECT_EQ(interpreted._player_count.max, compiled._player_count.max);
+    EXPECT_NE(interpreted.id(), compiled.id());
+    EXPECT_EQ(interpreted.rules().size(), compiled.rules().size());
+}
+
+TEST_F(CompiledGameTest, SameGameState){
+    for (auto& [name, list] : interpreted._game_state) {
+        ASSERT_EQ(compiled._game_state.count(name), 1);
+        Json interpretedJson = list;
+        Json compiledJson = compiled._game_state[name];
+        EXPECT_EQ(interpretedJson, compiledJson) << name;
+    }
+    EXPECT_EQ(interpreted._game_state.size(), compiled._game_state.size());
+    EXPECT_EQ(compiled._game_state["per-player"], compiled.per_player());
+}
+
+TEST_F(CompiledGameTest, SameGamePlay){
+    interpreted.run();
+    compiled.run();
+    expectSameOutput();
+
+    std::vector<std::string> choices = {"0", "1", "2", "0"};
+    for (auto& choice : choices) {
+        for (Game* game : {&interpreted, &compiled}) {
+            game->outputSent();
+            auto requests = game->inputRequests(); // answering a request removes it
+            for (auto& request : requests) {
+                if (request.user.id == 1) {
+                    game->registerPlayerInput(request.user, choice);
+                } else {
+                    game->inputRequestTimedout(request.user);
+                }
+            }
+            game->run();
+        }
+        expectSameOutput();
+    }
+    EXPECT_EQ(compiled.status(), GameStatus::Finished);
+}
+
+// the compiled rules yield and resume on the same steps as the interpreted ones
+TEST_F(CompiledGameTest, SameGamePlayWithBudget){
+    auto runSteps = [](Game& game) {
+        ExecutionBudget budget(3, ExecutionBudget::Clock::time_point::max());
+        game.run(budget);
+    };
+
+    for (unsigned run = 0; run < 200 && compiled.status() != GameStatus::Finished; run++) {
+        runSteps(interpreted);
+        runSteps(compiled);
+        expectSameOutput();
+
+        if (compiled.status() == GameStatus::AwaitingOutput) {
+            for (Game* game : {&interpreted, &compiled}) {
+                game->outputSent();
+                auto requests = game->inputRequests();
+                for (auto& request : requests) {
+                    game->registerPlayerInput(request.user, std::to_string(run % 3));
+                }
+            }
+        }
+    }
+    EXPECT_EQ(interpreted.status(), GameStatus::Finished);
+    EXPECT_EQ(compiled.status(), GameStatus::Finished);
+}
@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+#include "mpscQueue.h"
+#include "spscQueue.h"
+
+#include <thread>
+#include <vector>
+
+TEST(SPSCQueueTest, FifoWithinCapacity){
+    SPSCQueue<int> queue(3);
+    EXPECT_EQ(queue.capacity(), 4);
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.push(int{i}));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    int value;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(SPSCQueueTest, TransfersBetweenThreads){
+    constexpr int count = 100000;
+    SPSCQueue<int> queue(64);
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; i++) {
+            while (!queue.push(int{i})) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    int value;
+    while (expected < count) {
+        if (queue.pop(value)) {
+            ASSERT_EQ(value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(MPSCQueueTest, FifoWithinCapacity){
+    MPSCQueue<int> queue(4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.push(int{i}));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    std::vector<int> values;
+    EXPECT_EQ(queue.popBatch(values, 3), 3);
+    EXPECT_TRUE(queue.push(4));
+    EXPECT_EQ(queue.popBatch(values), 2);
+    EXPECT_EQ(values, std::vector<int>({0, 1, 2, 3, 4}));
+
+    int value;
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(MPSCQueueTest, TransfersFromManyThreads){
+    constexpr int producers = 4;
+    constexpr int count = 20000;
+    MPSCQueue<std::pair<int, int>> queue(64);
+
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; producer++) {
+        threads.emplace_back([&queue, producer]() {
+            for (int i = 0; i < count; i++) {
+                while (!queue.push({producer, i})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // values from a single producer arrive in the order they were pushed
+    std::vector<int> next(producers, 0);
+    std::vector<std::pair<int, int>> batch;
+    int received = 0;
+    while (received < producers * count) {
+        batch.clear();
+        if (queue.popBatch(batch) == 0) {
+            std::this_thread::yield();
+        }
+        for (auto& [producer, i] : batch) {
+            ASSERT_EQ(i, next[producer]);
+            next[producer]++;
+            received++;
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
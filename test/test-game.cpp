@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "InterpretJson.h"
+#include "game.h"
+#include "rules.h"
+
+// A game run in tiny budgeted slices must produce the same output as an unbounded run
+class BudgetedGameTest : public ::testing::Test{
+protected:
+    void SetUp() override{
+        User owner;
+        owner.id = 100;
+        unbounded = InterpretJson("Rock_Paper_Scissors", owner).interpret();
+        budgeted = InterpretJson("Rock_Paper_Scissors", owner).interpret();
+
+        User c1;
+        User c2;
+        c1.id = 1;
+        c2.id = 2;
+        for (Game* game : {&unbounded, &budgeted}) {
+            game->addPlayer(c1, "1");
+            game->addPlayer(c2, "2");
+        }
+    }
+
+    // runs the budgeted game one step per run until it stops, returns the number of runs
+    unsigned runInSlices(unsigned steps) {
+        unsigned runs = 0;
+        do {
+            ExecutionBudget budget(steps, ExecutionBudget::Clock::time_point::max());
+            budgeted.run(budget);
+            runs++;
+        } while (budgeted.status() == GameStatus::Running);
+        return runs;
+    }
+
+    void answerInput(Game& game, std::string choice) {
+        game.outputSent();
+        auto requests = game.inputRequests(); // answering a request removes it
+        for (auto& request : requests) {
+            game.registerPlayerInput(request.user, choice);
+        }
+    }
+
+    Game unbounded;
+    Game budgeted;
+};
+
+TEST_F(BudgetedGameTest, ExhaustedBudget){
+    ExecutionBudget noSteps(0, ExecutionBudget::Clock::time_point::max());
+    budgeted.run(noSteps);
+    EXPECT_EQ(budgeted.status(), GameStatus::Running);
+    EXPECT_TRUE(budgeted.globalMsgs().empty());
+
+    ExecutionBudget pastDeadline(100, ExecutionBudget::Clock::now());
+    budgeted.run(pastDeadline);
+    EXPECT_EQ(budgeted.status(), GameStatus::Running);
+    EXPECT_TRUE(pastDeadline.exhausted());
+}
+
+TEST_F(BudgetedGameTest, SameGamePlayInSlices){
+    unbounded.run();
+    EXPECT_GT(runInSlices(1), 1);
+    EXPECT_EQ(unbounded.status(), budgeted.status());
+    EXPECT_EQ(unbounded.globalMsgs(), budgeted.globalMsgs());
+    EXPECT_EQ(unbounded.inputRequests().size(), budgeted.inputRequests().size());
+
+    std::vector<std::string> choices = {"0", "1", "2", "0"};
+    for (auto& choice : choices) {
+        answerInput(unbounded, choice);
+        answerInput(budgeted, choice);
+        unbounded.run();
+        runInSlices(2);
+        EXPECT_EQ(unbounded.status(), budgeted.status());
+        EXPECT_EQ(unbounded.globalMsgs(), budgeted.globalMsgs());
+    }
+    EXPECT_EQ(budgeted.status(), GameStatus::Finished);
+}
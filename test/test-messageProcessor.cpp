@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+#include "messageProcessor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Every allocation made by the test binary is counted, so a test can check a code path does not allocate.
+// All the forms of operator new are replaced, so whatever one allocates the replaced delete frees with
+// the matching free (e.g. std::stable_partition takes its buffer from the nothrow form).
+static std::atomic<size_t> allocations{0};
+
+static void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept {
+    allocations++;
+    size = size ? size : 1;
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    // aligned_alloc takes a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* operator new(size_t size) {
+    if (void* memory = allocate(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* memory = allocate(size, static_cast<size_t>(alignment))) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+TEST(MessageProcessorTest, CommandTable){
+    for (const CommandWord& commandWord : COMMAND_WORDS) {
+        EXPECT_EQ(lookupCommand(commandWord.word), commandWord.command);
+    }
+    EXPECT_EQ(lookupCommand(""), std::nullopt);
+    EXPECT_EQ(lookupCommand("Join"), std::nullopt);
+    EXPECT_EQ(lookupCommand("joins"), std::nullopt);
+    static_assert(lookupCommand("create") == UserCommand::CREATE);
+}
+
+TEST(MessageProcessorTest, CommandArguments){
+    MessageProcessor messageProcessor;
+    Message message{{1}, "  join\t42  join \n"};
+    ProcessedMessage processed = messageProcessor.createProcessedMessage(message);
+
+    EXPECT_TRUE(processed.isCommand);
+    EXPECT_EQ(processed.commandType, UserCommand::JOIN);
+    ASSERT_EQ(processed.arguments.size(), 2);
+    EXPECT_EQ(processed.arguments[0], "42");
+    // an argument equal to the command word is kept
+    EXPECT_EQ(processed.arguments[1], "join");
+}
+
+TEST(MessageProcessorTest, Input){
+    MessageProcessor messageProcessor;
+    for (std::string text : {"rock paper scissors", "", "   "}) {
+        Message message{{1}, text};
+        ProcessedMessage processed = messageProcessor.createProcessedMessage(message);
+        EXPECT_FALSE(processed.isCommand);
+        EXPECT_EQ(processed.input, text);
+        EXPECT_EQ(processed.input.data(), message.text.data());
+    }
+}
+
+TEST(MessageProcessorTest, NoAllocations){
+    MessageProcessor messageProcessor;
+    Message command{{1}, "create 0 and some long trailing arguments that do not fit in a small string"};
+    Message input{{1}, "a game input long enough to live on the heap"};
+
+    size_t before = allocations;
+    ProcessedMessage processedCommand = messageProcessor.createProcessedMessage(command);
+    ProcessedMessage processedInput = messageProcessor.createProcessedMessage(input);
+    size_t after = allocations;
+
+    EXPECT_EQ(after - before, 0);
+    EXPECT_EQ(processedCommand.arguments.size(), 8);
+    EXPECT_EQ(processedInput.input, input.text);
+}
+
+TEST(MessageProcessorTest, BinaryFrames){
+    std::string frames;
+    FrameWriter create{frames, Opcode::Command};
+    create.u8(static_cast<uint8_t>(CommandCode::Create));
+    create.string("1");
+    create.finish();
+    FrameWriter choice{frames, Opcode::Choice};
+    choice.u32(2);
+    choice.finish();
+    frames.push_back(static_cast<char>(Opcode::Input)); // truncated frame
+
+    MessageProcessor messageProcessor;
+    // the processed messages view the incoming messages, which must stay alive
+    std::deque<Message> incoming{{{1}, frames, nullptr, Priority::Informational, nullptr, Protocol::Binary}};
+    auto processed = messageProcessor.getProcessedMessages(incoming);
+    ASSERT_EQ(processed.size(), 3);
+
+    EXPECT_TRUE(processed[0].isCommand);
+    EXPECT_EQ(processed[0].commandType, UserCommand::CREATE);
+    ASSERT_EQ(processed[0].arguments.size(), 1);
+    EXPECT_EQ(processed[0].arguments[0], "1");
+
+    EXPECT_FALSE(processed[1].isCommand);
+    EXPECT_EQ(processed[1].choice, 2u);
+    EXPECT_FALSE(processed[1].malformed);
+
+    EXPECT_TRUE(processed[2].malformed);
+}
@@ -0,0 +1,688 @@
+#include "gtest/gtest.h"
+#include "client.h"
+#include "server.h"
+#include "tickProfiler.h"
+#include "userTable.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Messages travel between a Client and a Server whose connections run on I/O threads
+class NetworkingTest : public ::testing::TestWithParam<unsigned>{
+protected:
+    // calls update() on both ends until done() holds, returns false if that takes too long
+    template <typename Done>
+    bool pump(Server& server, Client& client, Done done) {
+        for (int i = 0; i < 1000; i++) {
+            server.update();
+            client.update();
+            if (done()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return false;
+    }
+
+    std::vector<User> connected;
+    std::vector<User> disconnected;
+};
+
+TEST_P(NetworkingTest, RoundTrip){
+    ServerOptions options;
+    options.ioThreads = GetParam();
+
+    unsigned short port = 40400 + GetParam();
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port)};
+
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    client.send("hello");
+    std::deque<Message> received;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        auto messages = server.receive();
+        received.insert(received.end(), messages.begin(), messages.end());
+        return !received.empty();
+    }));
+    EXPECT_EQ(received.front().user, connected.front());
+    EXPECT_EQ(received.front().text, "hello");
+
+    server.send({{connected.front(), "welcome"}});
+    std::string reply;
+    if (GetParam() == 0) {
+        // without I/O threads the write starts within send(), not on the next update()
+        for (int i = 0; i < 1000 && reply.empty(); i++) {
+            client.update();
+            reply += client.receive();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        EXPECT_EQ(reply, "welcome");
+    }
+    ASSERT_TRUE(pump(server, client, [&]() {
+        reply += client.receive();
+        return !reply.empty();
+    }));
+    EXPECT_EQ(reply, "welcome");
+
+    // a payload is written from the same buffer for every message that shares it
+    Payload shared = makePayload("shared");
+    server.send({{connected.front(), {}, shared}, {connected.front(), {}, shared}});
+    reply.clear();
+    ASSERT_TRUE(pump(server, client, [&]() {
+        reply += client.receive();
+        return reply.size() == 2 * shared->size();
+    }));
+    EXPECT_EQ(reply, "sharedshared");
+    EXPECT_TRUE(pump(server, client, [&]() { return shared.use_count() == 1; }));
+
+    server.disconnect(connected.front());
+    EXPECT_EQ(disconnected.size(), 1);
+    EXPECT_TRUE(pump(server, client, [&]() { return client.isDisconnected(); }));
+    EXPECT_EQ(disconnected.size(), 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(IOThreads, NetworkingTest, ::testing::Values(0, 2));
+
+// Text arrives unchanged whether or not both ends negotiated permessage-deflate
+TEST_F(NetworkingTest, Compression){
+    Compression compression;
+    compression.enabled = true;
+    compression.windowBits = 10;
+    compression.noContextTakeover = true;
+    ServerOptions options;
+    options.compression = compression;
+
+    std::string prompt;
+    for (int i = 0; i < 100; i++) {
+        prompt += "Choose an option: rock, paper or scissors\n";
+    }
+
+    for (bool clientCompresses : {true, false}) {
+        connected.clear();
+        unsigned short port = clientCompresses ? 40410 : 40411;
+        Server server{port, "<html></html>",
+            [this](User user) { connected.push_back(user); },
+            [this](User user) { disconnected.push_back(user); },
+            options};
+        Client client{"127.0.0.1", std::to_string(port), clientCompresses ? compression : Compression{}};
+        ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+        server.send({{connected.front(), {}, makePayload(prompt)}});
+        std::string reply;
+        ASSERT_TRUE(pump(server, client, [&]() {
+            reply += client.receive();
+            return reply.size() >= prompt.size();
+        }));
+        EXPECT_EQ(reply, prompt);
+
+        client.send(prompt);
+        std::deque<Message> received;
+        ASSERT_TRUE(pump(server, client, [&]() {
+            auto messages = server.receive();
+            received.insert(received.end(), messages.begin(), messages.end());
+            return !received.empty();
+        }));
+        EXPECT_EQ(received.front().text, prompt);
+    }
+}
+
+// Droppable messages are shed while a connection is congested, a Client that stops
+// reading altogether is disconnected once the grace period runs out
+TEST_F(NetworkingTest, Backpressure){
+    ServerOptions options;
+    options.backpressure.highWatermarkMessages = 4;
+    options.backpressure.lowWatermarkMessages = 1;
+    options.backpressure.highWatermarkBytes = 1 << 20;
+    options.backpressure.lowWatermarkBytes = 1 << 10;
+    options.backpressure.gracePeriod = std::chrono::milliseconds(50);
+
+    unsigned short port = 40420;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port)};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+    User user = connected.front();
+
+    std::deque<Message> messages;
+    for (auto text : {"a", "b", "c"}) {
+        messages.push_back({user, text});
+    }
+    for (int i = 0; i < 10; i++) {
+        messages.push_back({user, "chat", nullptr, Priority::Chat});
+    }
+    server.send(std::move(messages));
+    std::string notice = "(10 chat messages were dropped while the connection caught up)\n";
+    std::string reply;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        reply += client.receive();
+        return reply.size() >= 3 + notice.size();
+    }));
+    EXPECT_EQ(reply, "abc" + notice);
+    EXPECT_TRUE(pump(server, client, [&]() { return server.queuedWrites(user).messages == 0; }));
+
+    // the client stops reading, the writes back up behind the socket buffers
+    Payload block = makePayload(std::string(1 << 20, 'x'));
+    messages.clear();
+    for (int i = 0; i < 64; i++) {
+        messages.push_back({user, {}, block});
+    }
+    server.send(std::move(messages));
+    server.update();
+    EXPECT_LT(0u, server.queuedWrites(user).bytes);
+    for (int i = 0; i < 500 && disconnected.empty(); i++) {
+        server.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_EQ(disconnected.size(), 1);
+    EXPECT_EQ(disconnected.front(), user);
+    EXPECT_EQ(server.queuedWrites(user).bytes, 0);
+}
+
+// A prompt queued behind other text is written before it
+TEST_F(NetworkingTest, PriorityClasses){
+    unsigned short port = 40421;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); }};
+    Client client{"127.0.0.1", std::to_string(port)};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+    User user = connected.front();
+
+    // the first message is written right away, the others queue up behind it
+    server.send({{user, "a"}, {user, "chat", nullptr, Priority::Chat}, {user, "b"},
+                 {user, "prompt", nullptr, Priority::Critical}});
+    std::string reply;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        reply += client.receive();
+        return reply.size() >= 12;
+    }));
+    EXPECT_EQ(reply, "apromptbchat");
+}
+
+// A Client answering pings stays connected without sending anything, one that went
+// silent is disconnected once the idle timeout passes
+TEST_F(NetworkingTest, Keepalive){
+    ServerOptions options;
+    options.keepalive.pingInterval = std::chrono::milliseconds(20);
+    options.keepalive.idleTimeout = std::chrono::milliseconds(80);
+
+    unsigned short port = 40430;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port)};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    auto quiet = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    ASSERT_TRUE(pump(server, client, [&]() { return quiet < std::chrono::steady_clock::now(); }));
+    EXPECT_TRUE(disconnected.empty());
+
+    // the client stops polling, so its pongs stop too
+    for (int i = 0; i < 500 && disconnected.empty(); i++) {
+        server.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_EQ(disconnected.size(), 1);
+    EXPECT_EQ(disconnected.front(), connected.front());
+}
+
+// Clients connecting all at once are spread over the acceptors of the I/O threads
+TEST_F(NetworkingTest, ConnectionStorm){
+    ServerOptions options;
+    options.ioThreads = 2;
+    options.listening.pendingAccepts = 4;
+
+    unsigned short port = 40440;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (int i = 0; i < 32; i++) {
+        clients.push_back(std::make_unique<Client>("127.0.0.1", std::to_string(port)));
+    }
+    for (int i = 0; i < 1000 && connected.size() < clients.size(); i++) {
+        server.update();
+        for (auto& client : clients) {
+            client->update();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    EXPECT_EQ(connected.size(), clients.size());
+    EXPECT_EQ(server.acceptStats().accepted, clients.size());
+    EXPECT_EQ(server.acceptStats().failed, 0);
+}
+
+// Binary protocol clients send frames and get the structured form of the messages sent to them
+TEST_F(NetworkingTest, BinaryProtocol){
+    unsigned short port = 40460;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); }};
+    Client client{"127.0.0.1", std::to_string(port), Compression{}, Protocol::Binary};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    std::string choice;
+    FrameWriter writer{choice, Opcode::Choice};
+    writer.u32(1);
+    writer.finish();
+    client.send(choice);
+    std::deque<Message> incoming;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        for (auto& message : server.receive()) {
+            incoming.push_back(std::move(message));
+        }
+        return !incoming.empty();
+    }));
+    EXPECT_EQ(incoming.front().protocol, Protocol::Binary);
+    EXPECT_EQ(incoming.front().text, choice);
+
+    std::string event;
+    FrameWriter gameState{event, Opcode::GameState};
+    gameState.u8(static_cast<uint8_t>(GameStateChange::Started));
+    gameState.u64(7);
+    gameState.finish();
+    std::deque<Message> messages;
+    messages.push_back({connected.front(), "Game Started!", nullptr, Priority::Informational, makePayload(event)});
+    messages.push_back({connected.front(), "plain text"});
+    server.send(std::move(messages));
+
+    std::string received;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        received += client.receive();
+        return received.size() >= event.size() + 15;
+    }));
+    std::string_view frames = received;
+    Opcode opcode;
+    std::string_view fields;
+    ASSERT_TRUE(nextFrame(frames, opcode, fields));
+    EXPECT_EQ(opcode, Opcode::GameState);
+    ASSERT_TRUE(nextFrame(frames, opcode, fields));
+    EXPECT_EQ(opcode, Opcode::Text);
+    EXPECT_EQ(fields, "plain text");
+    EXPECT_TRUE(frames.empty());
+}
+
+// A Client sending faster than its rate limit has the excess dropped, and is disconnected
+// once it keeps sending into an empty bucket
+TEST_F(NetworkingTest, RateLimit){
+    ServerOptions options;
+    options.rateLimit.messagesPerSecond = 0.1;
+    options.rateLimit.burst = 3;
+    options.rateLimit.maxDroppedInARow = 5;
+
+    unsigned short port = 40470;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port)};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    // the client writes one message at a time, each is either received or dropped
+    std::string received;
+    auto sendMessage = [&](int i) {
+        client.send(std::to_string(i));
+        return pump(server, client, [&]() {
+            for (auto& message : server.receive()) {
+                received += message.text;
+            }
+            return received.size() + server.rateLimitStats().dropped == static_cast<size_t>(i + 1);
+        });
+    };
+    for (int i = 0; i < 6; i++) {
+        ASSERT_TRUE(sendMessage(i));
+    }
+    EXPECT_EQ(received, "012");
+    EXPECT_EQ(server.rateLimitStats().dropped, 3);
+    EXPECT_TRUE(disconnected.empty());
+
+    ASSERT_TRUE(sendMessage(6));
+    ASSERT_TRUE(sendMessage(7));
+    ASSERT_TRUE(pump(server, client, [this]() { return !disconnected.empty(); }));
+    EXPECT_EQ(received, "012");
+    EXPECT_EQ(server.rateLimitStats().dropped, 5);
+    EXPECT_EQ(server.rateLimitStats().disconnected, 1);
+}
+
+// Every frame of a binary protocol message takes a token, the frames past the last one are dropped
+TEST_F(NetworkingTest, RateLimitPerFrame){
+    ServerOptions options;
+    options.rateLimit.messagesPerSecond = 0.1;
+    options.rateLimit.burst = 3;
+
+    unsigned short port = 40500;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port), Compression{}, Protocol::Binary};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    std::string choices;
+    for (uint32_t i = 0; i < 5; i++) {
+        FrameWriter writer{choices, Opcode::Choice};
+        writer.u32(i);
+        writer.finish();
+    }
+    client.send(choices);
+    std::deque<Message> incoming;
+    ASSERT_TRUE(pump(server, client, [&]() {
+        for (auto& message : server.receive()) {
+            incoming.push_back(std::move(message));
+        }
+        return !incoming.empty();
+    }));
+    ASSERT_EQ(incoming.size(), 1);
+    EXPECT_EQ(incoming.front().text, choices.substr(0, 3 * choices.size() / 5));
+    EXPECT_EQ(server.rateLimitStats().dropped, 2);
+}
+
+// A Client that keeps packing more frames into its messages than its rate limit allows is
+// disconnected, even though the first frame of each message gets through
+TEST_F(NetworkingTest, RateLimitFrameFlood){
+    ServerOptions options;
+    options.rateLimit.messagesPerSecond = 20;
+    options.rateLimit.burst = 1;
+    options.rateLimit.maxDroppedInARow = 5;
+
+    unsigned short port = 40510;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Client client{"127.0.0.1", std::to_string(port), Compression{}, Protocol::Binary};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    std::string choices;
+    for (uint32_t i = 0; i < 4; i++) {
+        FrameWriter writer{choices, Opcode::Choice};
+        writer.u32(i);
+        writer.finish();
+    }
+    // one message per refill, so the first frame always finds a token and the other three are dropped
+    std::deque<Message> incoming;
+    for (int i = 0; i < 2; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        client.send(choices);
+        ASSERT_TRUE(pump(server, client, [&]() {
+            for (auto& message : server.receive()) {
+                incoming.push_back(std::move(message));
+            }
+            return server.rateLimitStats().dropped == static_cast<uint64_t>(3 * (i + 1));
+        }));
+    }
+    ASSERT_TRUE(pump(server, client, [this]() { return !disconnected.empty(); }));
+    ASSERT_EQ(incoming.size(), 1);
+    EXPECT_EQ(incoming.front().text, choices.substr(0, choices.size() / 4));
+    EXPECT_EQ(server.rateLimitStats().disconnected, 1);
+}
+
+// sends a raw HTTP request and returns the raw response, the server closes the connection
+static std::string httpRequest(unsigned short port, const std::string& request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string response;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0
+            && write(fd, request.data(), request.size()) == static_cast<ssize_t>(request.size())) {
+        char buffer[4096];
+        for (ssize_t n; (n = read(fd, buffer, sizeof(buffer))) > 0;) {
+            response.append(buffer, n);
+        }
+    }
+    close(fd);
+    return response;
+}
+
+// Assets are served compressed when the client accepts it and only sent again when they changed
+TEST_F(NetworkingTest, StaticAssets){
+    std::string page(2000, 'x');
+    AssetBundle assets{page};
+    assets.add("/app.js", "let x = 1;");
+
+    ServerOptions options;
+    options.ioThreads = 1;
+
+    unsigned short port = 40450;
+    Server server{port, std::move(assets), [](User) {}, [](User) {}, options};
+
+    auto get = [port] (std::string target, std::string headers) {
+        return httpRequest(port, "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n"
+                                 + headers + "Connection: close\r\n\r\n");
+    };
+    auto header = [] (const std::string& response, const std::string& name) {
+        auto start = response.find("\r\n" + name + ": ");
+        if (start == std::string::npos) {
+            return std::string{};
+        }
+        start += name.size() + 4;
+        return response.substr(start, response.find("\r\n", start) - start);
+    };
+
+    auto plain = get("/", "");
+    EXPECT_EQ(plain.rfind("HTTP/1.1 200", 0), 0);
+    EXPECT_EQ(plain.substr(plain.size() - page.size()), page);
+    EXPECT_EQ(header(plain, "Cache-Control"), "no-cache");
+
+    auto gzipped = get("/index.html", "Accept-Encoding: gzip\r\n");
+    EXPECT_EQ(header(gzipped, "Content-Encoding"), "gzip");
+    EXPECT_LT(std::stoul(header(gzipped, "Content-Length")), page.size());
+    EXPECT_NE(header(gzipped, "ETag"), header(plain, "ETag"));
+
+    auto revalidated = get("/index.html", "If-None-Match: " + header(plain, "ETag") + "\r\n");
+    EXPECT_EQ(revalidated.rfind("HTTP/1.1 304", 0), 0);
+    auto weak = get("/index.html", "Accept-Encoding: gzip\r\nIf-None-Match: W/" + header(gzipped, "ETag") + "\r\n");
+    EXPECT_EQ(weak.rfind("HTTP/1.1 304", 0), 0);
+    EXPECT_EQ(header(weak, "Content-Encoding"), "gzip");
+
+    // the identity body is not current for a request that is sent the gzip encoding
+    auto other = get("/index.html", "Accept-Encoding: gzip\r\nIf-None-Match: " + header(plain, "ETag") + "\r\n");
+    EXPECT_EQ(other.rfind("HTTP/1.1 200", 0), 0);
+    EXPECT_EQ(header(other, "ETag"), header(gzipped, "ETag"));
+
+    // too small to be worth compressing
+    auto script = get("/app.js?v=1", "Accept-Encoding: gzip, br\r\n");
+    EXPECT_EQ(header(script, "Content-Encoding"), "");
+    EXPECT_EQ(header(script, "Content-Type").rfind("application/javascript", 0), 0);
+
+    EXPECT_EQ(get("/missing.css", "").rfind("HTTP/1.1 404", 0), 0);
+}
+
+// opens a websocket connection with a raw socket offering the extensions, returns the socket or -1
+static int websocketConnect(unsigned short port, const std::string& extensions = "") {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n"
+                          + (extensions.empty() ? "" : "Sec-WebSocket-Extensions: " + extensions + "\r\n") + "\r\n";
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+        close(fd);
+        return -1;
+    }
+    std::string response;
+    char c;
+    while (response.find("\r\n\r\n") == std::string::npos && read(fd, &c, 1) == 1) {
+        response += c;
+    }
+    if (response.rfind("HTTP/1.1 101", 0) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// writes a masked websocket frame of less than 126 bytes, opcode 0 continues a message,
+// the first frame of a compressed message has flags 0x40 (RSV1)
+static bool websocketWrite(int fd, bool fin, uint8_t opcode, const std::string& payload, uint8_t flags = 0) {
+    std::string frame;
+    frame += static_cast<char>((fin ? 0x80 : 0) | flags | opcode);
+    frame += static_cast<char>(0x80 | payload.size());
+    frame += std::string(4, '\0'); // a zero mask leaves the payload as it is
+    frame += payload;
+    return write(fd, frame.data(), frame.size()) == static_cast<ssize_t>(frame.size());
+}
+
+// A message whose first fragment inflates to nothing arrives with exactly the bytes of its other fragments
+TEST_F(NetworkingTest, FragmentedMessages){
+    ServerOptions options;
+    options.ioThreads = 1;
+    options.compression.enabled = true;
+
+    unsigned short port = 40490;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    auto update = [&](auto done) {
+        for (int i = 0; i < 1000 && !done(); i++) {
+            server.update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return done();
+    };
+
+    int fd = websocketConnect(port, "permessage-deflate");
+    ASSERT_NE(fd, -1);
+    ASSERT_TRUE(update([this]() { return !connected.empty(); }));
+
+    // deflate stored blocks, the first one is empty
+    using namespace std::string_literals;
+    ASSERT_TRUE(websocketWrite(fd, false, 0x1, "\x00\x00\x00\xff\xff"s, 0x40));
+    ASSERT_TRUE(websocketWrite(fd, true, 0x0, "\x00\x05\x00\xfa\xff" "hello"s));
+    ASSERT_TRUE(websocketWrite(fd, false, 0x1, ""));
+    ASSERT_TRUE(websocketWrite(fd, true, 0x0, "x"));
+    std::vector<std::string> received;
+    ASSERT_TRUE(update([&]() {
+        for (auto& message : server.receive()) {
+            received.push_back(message.text);
+        }
+        return received.size() == 2;
+    }));
+    EXPECT_EQ(received[0], "hello");
+    EXPECT_EQ(received[1], "x");
+    close(fd);
+}
+
+// A user that takes over the slot of a disconnected user never sees the state left behind
+TEST(UserTableTest, StaleIdsAreNotFound){
+    User first = User::fromSlot(3, 0);
+    User second = User::fromSlot(3, 1);
+    EXPECT_EQ(second.slot(), 3);
+    EXPECT_EQ(second.generation(), 1);
+
+    UserTable<std::string> names;
+    names[first] = "ann";
+    ASSERT_NE(names.find(first), nullptr);
+    EXPECT_EQ(*names.find(first), "ann");
+    EXPECT_EQ(names.find(second), nullptr);
+    EXPECT_FALSE(names.erase(second));
+
+    EXPECT_EQ(names[second], "");
+    EXPECT_EQ(names.find(first), nullptr);
+    EXPECT_EQ(names.size(), 1);
+    EXPECT_TRUE(names.erase(second));
+    EXPECT_EQ(names.size(), 0);
+}
+
+// The metrics of the server and those registered with it are served at /metrics
+TEST_F(NetworkingTest, Metrics){
+    ServerOptions options;
+    options.ioThreads = 1;
+
+    unsigned short port = 40480;
+    Server server{port, "<html></html>",
+        [this](User user) { connected.push_back(user); },
+        [this](User user) { disconnected.push_back(user); },
+        options};
+    Histogram& latency = server.metrics().histogram("test_latency_seconds", "Test latency.", 1e-6, "kind=\"a\"");
+    latency.record(3);
+    latency.record(100);
+    Client client{"127.0.0.1", std::to_string(port)};
+    ASSERT_TRUE(pump(server, client, [this]() { return !connected.empty(); }));
+
+    auto response = httpRequest(port, "GET /metrics HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+
+    EXPECT_NE(response.find("200 OK"), std::string::npos);
+    EXPECT_NE(response.find("# TYPE socialgaming_connections gauge\n"), std::string::npos);
+    EXPECT_NE(response.find("socialgaming_connections 1\n"), std::string::npos);
+    EXPECT_NE(response.find("socialgaming_accepted_connections_total 2\n"), std::string::npos);
+    EXPECT_NE(response.find("# TYPE test_latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_bucket{kind=\"a\",le=\"7e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_bucket{kind=\"a\",le=\"0.000127\"} 2\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_count{kind=\"a\"} 2\n"), std::string::npos);
+}
+
+// The buckets of a histogram keep every sample within an eighth of its value
+TEST(MetricsTest, HistogramBuckets){
+    for (uint64_t value : {0ull, 7ull, 8ull, 100ull, 12345ull, 1ull << 39}) {
+        size_t bucket = Histogram::bucketOf(value);
+        EXPECT_LE(value, Histogram::upperBound(bucket));
+        EXPECT_LE(Histogram::upperBound(bucket) - value, value / Histogram::SUB_BUCKETS);
+        EXPECT_TRUE(bucket == 0 || Histogram::upperBound(bucket - 1) < value);
+    }
+    EXPECT_EQ(Histogram::bucketOf(UINT64_MAX), Histogram::NUM_BUCKETS - 1);
+
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; value++) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.count(), 1000);
+    EXPECT_EQ(histogram.sum(), 500500);
+    EXPECT_NEAR(histogram.quantile(0.5), 500, 500 / Histogram::SUB_BUCKETS);
+    EXPECT_NEAR(histogram.quantile(0.99), 990, 990 / Histogram::SUB_BUCKETS);
+}
+
+// Ticks over the budget are flagged along with the time of each phase
+TEST(TickProfilerTest, FlagsSlowTicks){
+    Metrics metrics;
+    TickProfiler profiler{metrics, std::chrono::milliseconds(5)};
+    size_t fast = profiler.addPhase("fast");
+    size_t slow = profiler.addPhase("slow");
+
+    profiler.beginTick();
+    profiler.time(fast, [] () {});
+    EXPECT_FALSE(profiler.endTick());
+
+    profiler.beginTick();
+    profiler.time(fast, [] () {});
+    int result = profiler.time(slow, [] () {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return 7;
+    });
+    EXPECT_EQ(result, 7);
+    EXPECT_TRUE(profiler.endTick());
+
+    auto lastTick = profiler.describeLastTick();
+    EXPECT_EQ(lastTick.rfind("tick 2 took ", 0), 0);
+    EXPECT_NE(lastTick.find(": fast "), std::string::npos);
+    EXPECT_NE(lastTick.find(", slow "), std::string::npos);
+
+    auto dump = profiler.dump();
+    EXPECT_EQ(dump.rfind("2 ticks, 1 over the budget of 5.000 ms\n", 0), 0);
+    EXPECT_NE(dump.find("slowest tick 2 "), std::string::npos);
+
+    auto exposition = metrics.exposition();
+    EXPECT_NE(exposition.find("socialgaming_ticks_over_budget_total 1\n"), std::string::npos);
+    EXPECT_NE(exposition.find("socialgaming_tick_phase_seconds_count{phase=\"slow\"} 1\n"), std::string::npos);
+    EXPECT_NE(exposition.find("socialgaming_tick_phase_seconds_count{phase=\"fast\"} 2\n"), std::string::npos);
+}
@@ -0,0 +1,338 @@
+#include "gtest/gtest.h"
+#include "globalState.h"
+
+#include <algorithm>
+#include <thread>
+
+// Games are only processed when an event (input, timeout, pending output) makes them ready
+class GameSchedulerTest : public ::testing::Test{
+protected:
+    void SetUp() override{
+        owner.id = 100;
+        p1.id = 1;
+        p2.id = 2;
+        globalState.addClientToLobby(owner);
+        uintptr_t invitation = globalState.createGame(0, owner);
+        globalState.addClientToGame(p1, invitation);
+        globalState.addClientToGame(p2, invitation);
+        globalState.startGame(owner);
+    }
+
+    static bool hasMessageFor(const std::deque<Message>& messages, User user) {
+        return std::any_of(messages.begin(), messages.end(),
+            [user](const Message& message) { return message.user == user; });
+    }
+
+    // one tick per second, so the 10 second input timeout of Rock_Paper_Scissors spans 10 ticks
+    GlobalServerState globalState{1000};
+    User owner;
+    User p1;
+    User p2;
+};
+
+TEST_F(GameSchedulerTest, IdleUntilInput){
+    std::deque<Message> prompts = globalState.processGames();
+    EXPECT_TRUE(hasMessageFor(prompts, p1));
+    EXPECT_TRUE(hasMessageFor(prompts, p2));
+
+    EXPECT_TRUE(globalState.processGames().empty());
+
+    globalState.registerUserGameInput(p1, "1");
+    std::deque<Message> received = globalState.processGames();
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received.front().user, p1);
+    EXPECT_TRUE(globalState.processGames().empty());
+}
+
+TEST_F(GameSchedulerTest, InputTimeout){
+    globalState.processGames();
+    globalState.registerUserGameInput(p1, "1");
+    globalState.processGames();
+
+    // p2 never answers, the game wakes up once the timeout fires and continues with the next round
+    unsigned idle_ticks = 0;
+    std::deque<Message> messages;
+    while ((messages = globalState.processGames()).empty() && idle_ticks < 100) {
+        idle_ticks++;
+    }
+    EXPECT_GT(idle_ticks, 0);
+    EXPECT_LT(idle_ticks, 100);
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_EQ(messages.front().user, p2);
+
+    std::deque<Message> nextRound = globalState.processGames();
+    EXPECT_TRUE(hasMessageFor(nextRound, owner));
+    EXPECT_TRUE(hasMessageFor(nextRound, p1));
+}
+
+// An index beyond the choices is rejected, however large it is, typed or sent by a binary client
+TEST_F(GameSchedulerTest, OutOfRangeIndex){
+    globalState.processGames();
+
+    for (std::string input : {"3", "2147483648", "99999999999999999999", "-1"}) {
+        globalState.registerUserGameInput(p1, input);
+        std::deque<Message> rejected = globalState.processGames();
+        ASSERT_EQ(rejected.size(), 1);
+        EXPECT_EQ(rejected.front().text, "Invalid index, please enter a number between 0 and 2\n");
+    }
+    globalState.registerUserGameInput(p1, uint32_t{4000000000});
+    std::deque<Message> rejected = globalState.processGames();
+    ASSERT_EQ(rejected.size(), 1);
+    EXPECT_EQ(rejected.front().text, "Invalid index, please enter a number between 0 and 2\n");
+
+    globalState.registerUserGameInput(p1, uint32_t{2});
+    std::deque<Message> received = globalState.processGames();
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received.front().text, "Input Received, you entered: 2\nWaiting for other players...\n\n");
+}
+
+// With worker threads the games run on their shards while processGames() only collects their output
+TEST(ShardedGameTest, GamePlaysOnWorkerThreads){
+    GlobalServerState globalState{10, ExecutionLimits{}, 2};
+    User owner{100};
+    User p1{1};
+    User p2{2};
+    globalState.addClientToLobby(owner);
+    uintptr_t invitation = globalState.createGame(0, owner);
+    globalState.addClientToGame(p1, invitation);
+    globalState.addClientToGame(p2, invitation);
+    globalState.startGame(owner);
+    EXPECT_TRUE(globalState.isOngoingGame(owner));
+
+    auto waitForMessages = [&globalState]() {
+        std::deque<Message> messages;
+        for (int i = 0; i < 500 && messages.empty(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            messages = globalState.processGames();
+        }
+        return messages;
+    };
+
+    std::deque<Message> prompts = waitForMessages();
+    ASSERT_FALSE(prompts.empty());
+    // the shard counts its games in the metrics of the server state
+    Metrics& metrics = globalState.metrics();
+    EXPECT_EQ(metrics.gauge("socialgaming_games", "", "status=\"awaiting_input\"").value(), 1);
+    EXPECT_LT(0, metrics.gauge("socialgaming_pending_input_requests", "").value());
+
+    globalState.registerUserGameInput(p1, "1");
+    std::deque<Message> received = waitForMessages();
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received.front().user, p1);
+
+    globalState.endGame(owner);
+    EXPECT_FALSE(globalState.isInGame(p1));
+    EXPECT_TRUE(globalState.isInLobby(p1));
+}
+
+// Lobby chat lines of a tick are sent as one shared digest, capped at max_lines lines
+TEST(LobbyChatTest, DigestPerTick){
+    LobbyChat chat{2};
+    EXPECT_EQ(chat.takeDigest(), nullptr);
+
+    chat.publish("ann", "hi");
+    chat.publish("bob", "hello");
+    chat.publish("cy", "hey");
+    Payload digest = chat.takeDigest();
+    ASSERT_NE(digest, nullptr);
+    EXPECT_EQ(*digest, "ann : hi\nbob : hello\n(1 more lobby messages were dropped)\n");
+    EXPECT_EQ(chat.takeDigest(), nullptr);
+
+    GlobalServerState globalState{1000};
+    User u1{1};
+    User u2{2};
+    globalState.addClientToLobby(u1);
+    globalState.addClientToLobby(u2);
+    globalState.setName(u1, "ann");
+    globalState.setName(u2, "bob");
+    globalState.publishLobbyMessage(u1, "hi");
+    globalState.publishLobbyMessage(u2, "hello");
+
+    std::deque<Message> outgoing;
+    globalState.buildLobbyDigest(outgoing);
+    ASSERT_EQ(outgoing.size(), 2);
+    EXPECT_EQ(outgoing[0].payload, outgoing[1].payload);
+    EXPECT_EQ(*outgoing[0].payload, "ann : hi\nbob : hello\n");
+}
+
+// Rooms overflow into new shards, and chat only reaches the users of the same shard
+TEST(LobbyRoomsTest, BoundedFanOut){
+    LobbyRooms lobby{LobbyLimits{2, 10}};
+    User u1{1};
+    User u2{2};
+    User u3{3};
+    User u4{4};
+    for (User user : {u1, u2, u3}) {
+        lobby.rejoin(user);
+    }
+    lobby.join(u4, "poker");
+    EXPECT_EQ(lobby.roomName(u1), "lobby #1");
+    EXPECT_EQ(lobby.roomName(u3), "lobby #2");
+    EXPECT_EQ(lobby.roomName(u4), "poker");
+    EXPECT_EQ(lobby.roomsAsString(), "\nRooms:\n  lobby (3 users)\n  poker (1 users)\n\n");
+
+    lobby.publish(u1, "ann", "hi");
+    std::deque<Message> outgoing;
+    lobby.buildDigests(outgoing);
+    ASSERT_EQ(outgoing.size(), 2);
+    EXPECT_EQ(outgoing[0].user, u1);
+    EXPECT_EQ(outgoing[1].user, u2);
+
+    // a user leaving for a game comes back to their room, in a shard with space
+    lobby.leave(u4);
+    EXPECT_FALSE(lobby.contains(u4));
+    lobby.rejoin(u4);
+    EXPECT_EQ(lobby.roomName(u4), "poker");
+
+    lobby.forget(u1);
+    lobby.join(u4, "lobby");
+    EXPECT_EQ(lobby.roomName(u4), "lobby #1");
+}
+
+// Shards and rooms are removed once empty, so users cannot grow the lobby without bound
+TEST(LobbyRoomsTest, EmptyRoomsAreRemoved){
+    LobbyRooms lobby{LobbyLimits{2, 10, 8}};
+    User u1{1};
+    User u2{2};
+    User u3{3};
+    User u4{4};
+    for (User user : {u1, u2, u3, u4}) {
+        lobby.rejoin(user);
+    }
+    EXPECT_FALSE(lobby.join(u1, "a very long room name"));
+    EXPECT_EQ(lobby.roomName(u1), "lobby #1");
+    EXPECT_TRUE(lobby.join(u1, "poker"));
+    lobby.join(u2, "poker");
+    EXPECT_EQ(lobby.roomsAsString(), "\nRooms:\n  lobby (2 users)\n  poker (2 users)\n\n");
+
+    // the emptied first shard is removed, a new one takes its number
+    EXPECT_EQ(lobby.roomName(u3), "lobby");
+    lobby.join(u1, "lobby");
+    lobby.join(u2, "lobby");
+    EXPECT_EQ(lobby.roomsAsString(), "\nRooms:\n  lobby (4 users)\n\n");
+    EXPECT_EQ(lobby.roomName(u3), "lobby #2");
+    EXPECT_EQ(lobby.roomName(u1), "lobby #1");
+
+    lobby.publish(u3, "cat", "hi");
+    std::deque<Message> outgoing;
+    lobby.buildDigests(outgoing);
+    ASSERT_EQ(outgoing.size(), 2);
+    EXPECT_EQ(outgoing[0].user, u3);
+    EXPECT_EQ(outgoing[1].user, u4);
+
+    lobby.forgetAll({u1, u2, u3});
+    lobby.leave(u4);
+    EXPECT_EQ(lobby.roomsAsString(), "\nRooms:\n\n");
+    lobby.rejoin(u4);
+    EXPECT_EQ(lobby.roomName(u4), "lobby");
+}
+
+// Queued users are formed into as many games as possible, preferring full games
+TEST(MatchmakerTest, FormsGamesInBatches){
+    Matchmaker matchmaker;
+    for (uintptr_t id = 1; id <= 8; id++) {
+        matchmaker.enqueue(User{id}, 0);
+    }
+    matchmaker.enqueue(User{9}, 1);
+    matchmaker.remove(User{2});
+    EXPECT_EQ(matchmaker.queueLength(0), 7);
+
+    auto matches = matchmaker.formMatches([](int) { return Game::PlayerCount{2, 3}; });
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_EQ(matches[0].host, User{1});
+    EXPECT_EQ(matches[0].players, (std::vector<User>{User{3}, User{4}, User{5}}));
+    EXPECT_EQ(matches[1].host, User{6});
+    EXPECT_EQ(matches[1].players, (std::vector<User>{User{7}, User{8}}));
+    EXPECT_EQ(matchmaker.queueLength(0), 0);
+    EXPECT_FALSE(matchmaker.isQueued(User{6}));
+
+    // a single user can not form a game and keeps waiting
+    EXPECT_TRUE(matchmaker.formMatches([](int) { return Game::PlayerCount{2, 3}; }).empty());
+    EXPECT_TRUE(matchmaker.isQueued(User{9}));
+}
+
+TEST(MatchmakerTest, QueuedGameStarts){
+    GlobalServerState globalState{1000};
+    for (uintptr_t id = 1; id <= 3; id++) {
+        globalState.addClientToLobby(User{id});
+        globalState.queueForGame(User{id}, 0);
+    }
+
+    std::deque<Message> outgoing = globalState.processGames();
+    EXPECT_TRUE(globalState.isOwner(User{1}));
+    EXPECT_TRUE(globalState.isOngoingGame(User{1}));
+    EXPECT_TRUE(globalState.isInGame(User{3}));
+    EXPECT_FALSE(globalState.isInLobby(User{2}));
+    EXPECT_EQ(globalState.getQueueLength(0), 0);
+    EXPECT_FALSE(outgoing.empty());
+}
+
+// All the network thread knows about a user lives in their session, dropped on disconnect
+TEST(SessionTest, FollowsTheUser){
+    using Session = GlobalServerState::Session;
+    GlobalServerState globalState{1000};
+    User user{1};
+    std::vector<User> newUsers{user};
+    globalState.addNewUsers(newUsers);
+    ASSERT_NE(globalState.getSession(user), nullptr);
+    EXPECT_EQ(globalState.getSession(user)->location, Session::Connected);
+    EXPECT_EQ(globalState.getName(user), "error");
+
+    globalState.addClientToLobby(user);
+    globalState.setName(user, "ann");
+    uintptr_t gameID = globalState.createGame(0, user);
+    const Session* session = globalState.getSession(user);
+    EXPECT_EQ(session->name, "ann");
+    EXPECT_EQ(session->location, Session::InGame);
+    EXPECT_EQ(session->game, gameID);
+    EXPECT_TRUE(session->owner);
+    EXPECT_FALSE(globalState.isInLobby(user));
+
+    globalState.endGame(user);
+    EXPECT_EQ(session->location, Session::InLobby);
+    EXPECT_FALSE(globalState.isOwner(user));
+    EXPECT_TRUE(globalState.isInLobby(user));
+
+    globalState.disconnectUser(user);
+    EXPECT_EQ(globalState.getSession(user), nullptr);
+    EXPECT_FALSE(globalState.isInLobby(user));
+}
+
+// Users lost together are removed in one batch with a single notice per affected game
+TEST(BulkDisconnectTest, OneNoticePerGame){
+    GlobalServerState globalState{1000};
+    std::vector<User> users;
+    for (uintptr_t id = 1; id <= 7; id++) {
+        users.push_back(User{id});
+    }
+    std::vector<User> newUsers = users;
+    globalState.addNewUsers(newUsers);
+    for (auto user : users) {
+        globalState.addClientToLobby(user);
+        globalState.setName(user, "u" + std::to_string(user.id));
+    }
+    uintptr_t kept = globalState.createGame(0, User{1});
+    for (uintptr_t id : {2, 3, 4}) {
+        globalState.addClientToGame(User{id}, kept);
+    }
+    uintptr_t ended = globalState.createGame(0, User{5});
+    globalState.addClientToGame(User{6}, ended);
+
+    std::deque<Message> outgoing;
+    globalState.disconnectUsers({User{2}, User{3}, User{5}, User{7}}, outgoing);
+
+    ASSERT_EQ(outgoing.size(), 3);
+    EXPECT_EQ(outgoing[0].user, User{6});
+    EXPECT_EQ(*outgoing[0].payload, "\nOwner left the server. Game Ended!\n\n");
+    EXPECT_EQ(outgoing[1].user, User{4});
+    EXPECT_EQ(*outgoing[1].payload, "\nu2, u3 left\n\n");
+    EXPECT_EQ(outgoing[2].user, User{1});
+    EXPECT_EQ(outgoing[2].text, "\nu2, u3 left\n\nPlayer Count : 1\n\n");
+
+    EXPECT_EQ(globalState.getPlayerCount(User{1}), 1);
+    EXPECT_FALSE(globalState.isValidGameInvitation(ended));
+    EXPECT_TRUE(globalState.isInLobby(User{6}));
+    for (uintptr_t id : {2, 3, 5, 7}) {
+        EXPECT_EQ(globalState.getSession(User{id}), nullptr);
+    }
+}
@@ -0,0 +1,153 @@
+#include "server.h"
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Measures the memory a Server holds per idle websocket connection. The connections are
+// opened by a child process, so only the Server's side is counted in the resident size.
+
+constexpr size_t MAX_PENDING_HANDSHAKES = 256;
+// spread over several loopback addresses so the clients do not run out of ephemeral ports
+constexpr size_t CONNECTIONS_PER_ADDRESS = 20000;
+constexpr auto CONNECT_TIMEOUT = std::chrono::seconds(300);
+constexpr auto SETTLE_TIME = std::chrono::milliseconds(500);
+
+size_t residentBytes() {
+    std::ifstream statm{"/proc/self/statm"};
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void raiseFileLimit(size_t connections) {
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < connections + 64) {
+        LOG(WARNING) << "The file descriptor limit (" << limit.rlim_cur << ") is too low for "
+                     << connections << " connections, raise it with ulimit -n";
+    }
+}
+
+/**
+ *  Opens websocket connections to the Server and leaves them idle.
+ */
+class Connector {
+public:
+    using Websocket = boost::beast::websocket::stream<boost::asio::ip::tcp::socket>;
+
+    Connector(boost::asio::io_context& ioContext, unsigned short port, size_t count)
+        : ioContext{ioContext},
+        port{port},
+        count{count}
+    { }
+
+    void start() {
+        for (size_t i = 0; i < MAX_PENDING_HANDSHAKES; i++) {
+            connectNext();
+        }
+    }
+
+private:
+    void connectNext() {
+        if (next == count) {
+            return;
+        }
+        uint32_t address = INADDR_LOOPBACK + next / CONNECTIONS_PER_ADDRESS;
+        next++;
+
+        websockets.push_back(std::make_unique<Websocket>(ioContext));
+        Websocket& websocket = *websockets.back();
+        websocket.next_layer().async_connect({boost::asio::ip::address_v4{address}, port},
+            [this, &websocket] (auto errorCode) {
+                if (errorCode) {
+                    LOG(ERROR) << "Unable to connect: " << errorCode.message();
+                    connectNext();
+                    return;
+                }
+                websocket.async_handshake("localhost", "/", [this] (auto errorCode) {
+                    if (errorCode) {
+                        LOG(ERROR) << "Unable to handshake: " << errorCode.message();
+                    }
+                    connectNext();
+                });
+            }
+        );
+    }
+
+    boost::asio::io_context& ioContext;
+    unsigned short port;
+    size_t count;
+    size_t next = 0;
+    std::vector<std::unique_ptr<Websocket>> websockets;
+};
+
+int main(int argc, char *argv[]) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    if (argc < 2) {
+        LOG(ERROR) << "Usage:\n  " << argv[0] << " port [connections]\n"
+                   << "  e.g. " << argv[0] << " 4050 100000\n";
+        return 1;
+    }
+    unsigned short port = std::stoi(argv[1]);
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 100000;
+    raiseFileLimit(count);
+
+    size_t connected = 0;
+    Server server{port, "", [&connected] (User) { connected++; }, [&connected] (User) { connected--; }};
+    server.update();
+    size_t before = residentBytes();
+
+    pid_t clients = fork();
+    if (clients == 0) {
+        boost::asio::io_context ioContext;
+        Connector connector{ioContext, port, count};
+        connector.start();
+        ioContext.run();
+        pause(); // keep the connections open until the benchmark is done
+        return 0;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    while (connected < count && std::chrono::steady_clock::now() < deadline) {
+        server.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto settled = std::chrono::steady_clock::now() + SETTLE_TIME;
+    while (std::chrono::steady_clock::now() < settled) {
+        server.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    size_t after = residentBytes();
+
+    kill(clients, SIGTERM);
+    waitpid(clients, nullptr, 0);
+
+    if (connected == 0) {
+        LOG(ERROR) << "No connection was established";
+        return 1;
+    }
+    std::cout << "idle connections: " << connected << "\n"
+              << "resident bytes before: " << before << "\n"
+              << "resident bytes after: " << after << "\n"
+              << "bytes per idle connection: " << (after - before) / connected << "\n";
+    return 0;
+}
@@ -0,0 +1,398 @@
+#include "GameCompiler.h"
+
+#include <glog/logging.h>
+
+std::string getTextToReplace(std::string str);
+
+namespace {
+
+std::string structName(unsigned rule) {
+    return "Rule" + std::to_string(rule);
+}
+
+std::string memberName(unsigned rule) {
+    return "rule" + std::to_string(rule);
+}
+
+}
+
+GameCompiler::GameCompiler(std::string configPath)
+    : interpreter(InterpretJson::fromFile(configPath)) {
+}
+
+std::string GameCompiler::compile() {
+    if (interpreter.data.is_null()) {
+        return "";
+    }
+    // run the front end to build the game state the expression trees are bound to
+    game = interpreter.interpret();
+
+    ElementSptr rule_structure;
+    interpreter.data.at("rules").get_to(rule_structure);
+    std::vector<unsigned> rules = emitRules(rule_structure);
+
+    std::stringstream source;
+    source << "// Generated by gamecompiler from " << interpreter.game_name << ".json. Do not edit.\n\n"
+           << "#include \"compiledGame.h\"\n"
+           << "#include \"compiledRules.h\"\n"
+           << "#include \"ExpressionTree.h\"\n\n"
+           << "namespace {\n\n"
+           << "constexpr const char* configName = " << CodeEmitter::quote(interpreter.game_name) << ";\n"
+           << "constexpr const char* name = " << CodeEmitter::quote(interpreter.data.at("configuration").at("name").get<std::string>()) << ";\n"
+           << "constexpr bool audience = " << (game._has_audience ? "true" : "false") << ";\n"
+           << "constexpr unsigned minPlayers = " << game._player_count.min << ";\n"
+           << "constexpr unsigned maxPlayers = " << game._player_count.max << ";\n\n"
+           << emitTable("setup", game.setup())
+           << emitTable("constants", game.constants())
+           << emitTable("variables", game.variables())
+           << emitTable("perPlayer", game.per_player())
+           << emitTable("perAudience", game.per_audience())
+           << rulesCode.str()
+           << "void buildRules(Game& game) {\n"
+           << "    CompiledContext context{ game._players, game._global_msgs, game._input_requests, game._player_input, {\n";
+    for (auto& list : emitter.boundLists()) {
+        source << "        inGameState(" << CodeEmitter::quote(list) << ", game._game_state),\n";
+    }
+    source << "    } };\n"
+           << "    game._rules = {";
+    for (size_t i = 0; i < rules.size(); i++) {
+        source << (i ? ", " : " ") << "std::make_shared<CompiledRule<" << structName(rules[i]) << ">>(context)";
+    }
+    source << (rules.empty() ? "};\n" : " };\n")
+           << "}\n\n"
+           << "void build(Game& game) {\n"
+           << "    game._name = name;\n"
+           << "    game._has_audience = audience;\n"
+           << "    game._player_count = { minPlayers, maxPlayers };\n"
+           << "    game._per_player = unbake(perPlayer);\n"
+           << "    game._per_audience = unbake(perAudience);\n"
+           << "    game._game_state = {\n"
+           << "        {\"constants\", unbake(constants)},\n"
+           << "        {\"variables\", unbake(variables)},\n"
+           << "        {\"setup\", unbake(setup)},\n"
+           << "        {\"per-player\", game._per_player},\n"
+           << "        {\"per-audience\", game._per_audience}\n"
+           << "    };\n"
+           << "    buildRules(game);\n"
+           << "}\n\n"
+           << "constexpr GamePlugin plugin { configName, build };\n\n"
+           << "} // namespace\n\n"
+           << "extern \"C\" const GamePlugin* " << GAME_PLUGIN_ENTRY << "() {\n"
+           << "    return &plugin;\n"
+           << "}\n";
+    return source.str();
+}
+
+//////////////////////////////      BAKED LISTS     //////////////////////////////
+
+std::string GameCompiler::emitTable(const std::string& tableName, const ElementSptr& list) {
+    std::vector<BakedElement> table(1);
+    std::vector<std::string> strings;
+    bake(table, strings, list, "", 0);
+    strings.resize(table.size() * 2);
+
+    auto literal = [](const std::string& str) {
+        return str.empty() ? std::string("nullptr") : CodeEmitter::quote(str);
+    };
+    auto typeName = [](BakedType type) {
+        switch (type) {
+            case BakedType::Int: return "BakedType::Int";
+            case BakedType::Bool: return "BakedType::Bool";
+            case BakedType::String: return "BakedType::String";
+            case BakedType::Vector: return "BakedType::Vector";
+            case BakedType::Map: return "BakedType::Map";
+        }
+        return "";
+    };
+
+    // keys and string payloads are recorded in strings as (key, text) pairs for each slot
+    std::stringstream code;
+    code << "constexpr BakedElement " << tableName << "[] = {\n";
+    for (size_t i = 0; i < table.size(); i++) {
+        const BakedElement& baked = table[i];
+        code << "    { " << typeName(baked.type) << ", "
+             << literal(strings[2*i]) << ", "
+             << baked.value << ", "
+             << (baked.type == BakedType::String ? CodeEmitter::quote(strings[2*i + 1]) : "nullptr") << ", "
+             << baked.first_child << ", " << baked.num_children << " },\n";
+    }
+    code << "};\n\n";
+    return code.str();
+}
+
+void GameCompiler::bake(std::vector<BakedElement>& table, std::vector<std::string>& strings,
+                        const ElementSptr& element, const std::string& key, size_t slot) {
+    strings.resize(table.size() * 2);
+    strings[2*slot] = key;
+    BakedElement baked{BakedType::Map, nullptr, 0, nullptr, 0, 0};
+
+    switch (element->type) {
+        case Type::INT:
+            baked.type = BakedType::Int;
+            baked.value = element->getInt();
+            break;
+        case Type::BOOL:
+            baked.type = BakedType::Bool;
+            baked.value = element->getBool();
+            break;
+        case Type::STRING:
+            baked.type = BakedType::String;
+            strings[2*slot + 1] = element->getString();
+            break;
+        case Type::VECTOR: {
+            ElementVector vector = element->getVector();
+            baked.type = BakedType::Vector;
+            baked.first_child = table.size();
+            baked.num_children = vector.size();
+            table.resize(table.size() + vector.size());
+            for (size_t i = 0; i < vector.size(); i++) {
+                bake(table, strings, vector[i], "", baked.first_child + i);
+            }
+            break;
+        }
+        case Type::MAP: {
+            ElementMap map = element->getMap();
+            baked.type = BakedType::Map;
+            baked.first_child = table.size();
+            baked.num_children = map.size();
+            table.resize(table.size() + map.size());
+            size_t i = 0;
+            for (auto& [child_key, child] : map) {
+                bake(table, strings, child, child_key, baked.first_child + i++);
+            }
+            break;
+        }
+        default:
+            LOG(ERROR) << "Unsupported list element type for key " << key;
+            break;
+    }
+    table[slot] = baked;
+}
+
+//////////////////////////////      RULES     //////////////////////////////
+
+CodeEmitter& GameCompiler::emitExpression(const std::string& expression) {
+    interpreter.expressionTree.build(expression);
+    auto root = interpreter.expressionTree.getRoot();
+    if (root != nullptr && !interpreter.expressionTree.splitString(expression).empty()) {
+        lastExpression = root;
+    }
+    if (lastExpression == nullptr) {
+        LOG(ERROR) << "Empty expression without a previous one to reuse";
+        lastExpression = std::make_shared<NameNode>(expression);
+    }
+
+    ElementMap elements;
+    lastExpression->accept(emitter, elements);
+    return emitter;
+}
+
+std::vector<unsigned> GameCompiler::emitRules(const ElementSptr& rules_from_json) {
+    std::vector<unsigned> rules;
+    for (auto rule : rules_from_json->getVector()) {
+        rules.push_back(emitRule(rule));
+    }
+    return rules;
+}
+
+std::string GameCompiler::emitSequence(const std::vector<unsigned>& rules, const std::string& rule,
+                                       const std::string& onStatus, const std::string& indent) {
+    if (rules.empty()) {
+        return "";
+    }
+    std::stringstream code;
+    code << indent << "for (; " << rule << " < " << rules.size() << "; " << rule << "++) {\n"
+         << indent << "    RuleStatus status = RuleStatus::Done;\n"
+         << indent << "    switch (" << rule << ") {\n";
+    for (size_t i = 0; i < rules.size(); i++) {
+        code << indent << "        case " << i << ": status = executeWithBudget("
+             << memberName(rules[i]) << ", context, game_state, budget, resuming); break;\n";
+    }
+    code << indent << "    }\n";
+    std::stringstream lines(onStatus);
+    for (std::string line; std::getline(lines, line);) {
+        code << indent << "    " << line << "\n";
+    }
+    code << indent << "}\n";
+    return code.str();
+}
+
+unsigned GameCompiler::emitRule(const ElementSptr& rule) {
+    std::string ruleName = rule->getMapElement("rule")->getString();
+    auto field = [&rule](const std::string& key) {
+        return CodeEmitter::quote(rule->getMapElement(key)->getString());
+    };
+    // the element a message refers to, only resolved if the message has a placeholder
+    auto placeholder = [this](const std::string& msg) {
+        return msg.find("{") == std::string::npos ? std::string("nullptr") : emitExpression(getTextToReplace(msg)).getResult();
+    };
+    const std::string returnUnlessDone = "if (status != RuleStatus::Done) return status;";
+    std::stringstream members;
+    std::stringstream body;
+
+    if (ruleName == "foreach") {
+        auto list = emitExpression(rule->getMapElement("list")->getString()).getResult();
+        auto subRules = emitRules(rule->getMapElement("rules"));
+        members << "    ElementVector elements;\n"
+                << "    size_t element = 0;\n"
+                << "    size_t rule = 0;\n"
+                << "    bool initialized = false;\n"
+                << "    bool resuming = false;\n";
+        for (unsigned subRule : subRules) {
+            members << "    " << structName(subRule) << " " << memberName(subRule) << ";\n";
+        }
+        body << "        if (!initialized) {\n"
+             << "            elements = " << list << "->getVector();\n"
+             << "            element = 0;\n"
+             << "            rule = 0;\n"
+             << "            initialized = true;\n"
+             << "        }\n"
+             << "        for (; element < elements.size(); element++) {\n"
+             << "            game_state[" << field("element") << "] = elements[element];\n"
+             << emitSequence(subRules, "rule", returnUnlessDone, "            ")
+             << "            rule = 0;\n"
+             << "        }\n"
+             << "        initialized = false;\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "global-message") {
+        auto element = placeholder(rule->getMapElement("value")->getString());
+        body << "        context.global_msgs->push_back(formatString(" << field("value") << ", " << element << "));\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "parallelfor") {
+        auto subRules = emitRules(rule->getMapElement("rules"));
+        members << "    std::map<User, size_t> player_rule;\n"
+                << "    std::map<User, bool> player_awaiting_input; // players that reached an input rule during the current pass\n"
+                << "    bool initialized = false;\n"
+                << "    bool resuming = false;\n";
+        for (unsigned subRule : subRules) {
+            members << "    " << structName(subRule) << " " << memberName(subRule) << ";\n";
+        }
+        body << "        if (!initialized) {\n"
+             << "            for (auto& [player_connection, _] : *context.players) {\n"
+             << "                player_rule[player_connection] = 0;\n"
+             << "            }\n"
+             << "            initialized = true;\n"
+             << "        }\n"
+             << "        for (auto& [player_connection, player] : *context.players) {\n"
+             << "            if (player_awaiting_input[player_connection]) continue;\n"
+             << "            game_state[" << field("element") << "] = player;\n"
+             << "            auto& rule = player_rule[player_connection];\n"
+             << emitSequence(subRules, "rule",
+                    "if (status == RuleStatus::Yielded) return status;\n"
+                    "if (status == RuleStatus::InputRequired) {\n"
+                    "    player_awaiting_input[player_connection] = true;\n"
+                    "    break;\n"
+                    "}", "            ")
+             << "        }\n"
+             << "        RuleStatus status = std::any_of(player_awaiting_input.begin(), player_awaiting_input.end(),\n"
+             << "            [](auto& awaiting) { return awaiting.second; }) ? RuleStatus::InputRequired : RuleStatus::Done;\n"
+             << "        player_awaiting_input.clear();\n"
+             << "        if (status == RuleStatus::Done) initialized = false;\n"
+             << "        return status;\n";
+    }
+    else if (ruleName == "input-choice") {
+        auto element = placeholder(rule->getMapElement("prompt")->getString());
+        auto choices = emitExpression(rule->getMapElement("choices")->getString()).getResult();
+        members << "    ElementVector choices;\n"
+                << "    std::map<User, bool> awaiting_input;\n";
+        body << "        User player_connection = game_state[\"player\"]->getMapElement(\"user\")->getConnection();\n"
+             << "        if (!awaiting_input[player_connection]) {\n"
+             << "            choices = " << choices << "->getVector();\n"
+             << "            context.input_requests->push_back(makeChoiceRequest(player_connection, formatString("
+             << field("prompt") << ", " << element << "), choices, " << rule->getMapElement("timeout")->getInt() << "));\n"
+             << "            awaiting_input[player_connection] = true;\n"
+             << "            return RuleStatus::InputRequired;\n"
+             << "        }\n"
+             << "        int chosen_index = chosenIndex(context.player_input->at(player_connection));\n"
+             << "        game_state[\"player\"]->setMapElement(" << field("result") << ", choices[chosen_index]);\n"
+             << "        awaiting_input[player_connection] = false;\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "add") {
+        auto to = emitExpression(rule->getMapElement("to")->getString()).getResult();
+        auto value = emitExpression(rule->getMapElement("value")->getString()).getInt();
+        body << "        " << to << "->addInt(" << value << ");\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "scores") {
+        body << "        context.global_msgs->push_back(scoresMessage(*context.players, " << field("score") << ", "
+             << (rule->getMapElement("ascending")->getBool() ? "true" : "false") << "));\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "extend") {
+        auto target = emitExpression(rule->getMapElement("target")->getString()).getResult();
+        auto list = emitExpression(rule->getMapElement("list")->getString()).getResult();
+        body << "        " << target << "->extend(" << list << ");\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "discard") {
+        auto from = emitExpression(rule->getMapElement("from")->getString()).getResult();
+        auto count = emitExpression(rule->getMapElement("count")->getString()).getInt();
+        body << "        " << from << "->discard(" << count << ");\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else if (ruleName == "when") {
+        std::vector<std::string> conditions;
+        std::vector<std::vector<unsigned>> caseRules;
+        for (auto& caseRulePair : rule->getMapElement("cases")->getVector()) {
+            conditions.push_back(emitExpression(caseRulePair->getMapElement("condition")->getString()).getBool());
+            caseRules.push_back(emitRules(caseRulePair->getMapElement("rules")));
+        }
+        members << "    size_t next_case = 0; // the case tested next, or the case that matched\n"
+                << "    size_t rule = 0;\n"
+                << "    bool matched = false;\n"
+                << "    bool resuming = false;\n";
+        for (auto& rules : caseRules) {
+            for (unsigned caseRule : rules) {
+                members << "    " << structName(caseRule) << " " << memberName(caseRule) << ";\n";
+            }
+        }
+        body << "        for (; !matched && next_case < " << conditions.size() << "; next_case++) {\n"
+             << "            if (!budget.spend()) {\n"
+             << "                return RuleStatus::Yielded;\n"
+             << "            }\n"
+             << "            bool caseMatch = false;\n"
+             << "            switch (next_case) {\n";
+        for (size_t i = 0; i < conditions.size(); i++) {
+            body << "                case " << i << ": caseMatch = " << conditions[i] << "; break;\n";
+        }
+        body << "            }\n"
+             << "            if (caseMatch) {\n"
+             << "                rule = 0;\n"
+             << "                matched = true;\n"
+             << "                break;\n"
+             << "            }\n"
+             << "        }\n"
+             << "        if (matched) {\n"
+             << "            switch (next_case) {\n";
+        for (size_t i = 0; i < caseRules.size(); i++) {
+            body << "                case " << i << ":\n"
+                 << emitSequence(caseRules[i], "rule", returnUnlessDone, "                    ")
+                 << "                    break;\n";
+        }
+        body << "            }\n"
+             << "        }\n"
+             << "        matched = false;\n"
+             << "        next_case = 0;\n"
+             << "        rule = 0;\n"
+             << "        return RuleStatus::Done;\n";
+    }
+    else {
+        // unknown rules are left empty, as in InterpretJson::toRuleVec
+        LOG(ERROR) << "Unknown rule " << ruleName;
+        body << "        return RuleStatus::Done;\n";
+    }
+
+    unsigned number = nextRule++;
+    rulesCode << "// " << ruleName << "\n"
+              << "struct " << structName(number) << " {\n"
+              << members.str()
+              << (members.str().empty() ? "" : "\n")
+              << "    RuleStatus execute(CompiledContext& context, ElementMap& game_state, ExecutionBudget& budget) {\n"
+              << body.str()
+              << "    }\n"
+              << "};\n\n";
+    return number;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "InterpretJson.h"
+#include "CodeEmitter.h"
+#include "compiledGame.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Compiles a game configuration into C++ source for a compiled game (see compiledGame.h).
+ *
+ * The configuration is read with the InterpretJson front end, so the generated game
+ * starts from exactly the state and expression trees the interpreter would build:
+ *  - setup, constants, variables, per-player and per-audience are baked into constexpr tables
+ *  - every rule becomes a struct whose execute() runs it natively (see compiledRules.h),
+ *    with the expressions it resolves emitted as C++ by CodeEmitter
+ */
+class GameCompiler {
+public:
+    explicit GameCompiler(std::string configPath);
+
+    /**
+     * Returns the generated source, or an empty string if the configuration could not be read
+     */
+    std::string compile();
+
+private:
+    InterpretJson interpreter;
+    Game game;
+
+    std::stringstream rulesCode;
+    unsigned nextRule = 0;
+    CodeEmitter emitter;
+    std::shared_ptr<ASTNode> lastExpression;
+
+    std::string emitTable(const std::string& tableName, const ElementSptr& list);
+    void bake(std::vector<BakedElement>& table, std::vector<std::string>& strings,
+              const ElementSptr& element, const std::string& key, size_t slot);
+
+    /**
+     * Emits the structs of the rules and of the rules within them, returns the number of each rule
+     */
+    std::vector<unsigned> emitRules(const ElementSptr& rules_from_json);
+    unsigned emitRule(const ElementSptr& rule);
+
+    /**
+     * Emits the execution of rules from the one at index rule onwards, running onStatus
+     * after each of them. The executing struct holds them as members and has a resuming flag.
+     */
+    std::string emitSequence(const std::vector<unsigned>& rules, const std::string& rule,
+                             const std::string& onStatus, const std::string& indent);
+
+    /**
+     * Emits the expression string, the emitter holds its code afterwards.
+     * NOTE: like ExpressionTree::build(), an empty expression reuses the previous one
+     */
+    CodeEmitter& emitExpression(const std::string& expression);
+};
@@ -0,0 +1,33 @@
+#include "GameCompiler.h"
+#include <glog/logging.h>
+
+#include <fstream>
+#include <iostream>
+
+// Compiles a game configuration (eg. gameconfigs/Rock_Paper_Scissors.json) into the C++ source
+// of a compiled game that the server can load in place of interpreting the configuration.
+int main(int argc, char* argv[]) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+
+    if (argc < 3) {
+        std::cerr << "Usage:\n  " << argv[0] << " <game config json> <output cpp>\n"
+                  << "  e.g. " << argv[0] << " gameconfigs/Rock_Paper_Scissors.json Rock_Paper_Scissors.cpp\n";
+        return 1;
+    }
+
+    GameCompiler compiler(argv[1]);
+    std::string source = compiler.compile();
+    if (source.empty()) {
+        LOG(ERROR) << "Unable to compile " << argv[1];
+        return 1;
+    }
+
+    std::ofstream output(argv[2]);
+    output << source;
+    if (!output) {
+        LOG(ERROR) << "Unable to write " << argv[2];
+        return 1;
+    }
+    return 0;
+}
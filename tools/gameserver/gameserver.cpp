@@ -2,10 +2,13 @@
 #include "globalState.h"
 #include "messageProcessor.h"
 #include "server.h"
+#include "tickProfiler.h"
 #include <glog/logging.h>
 
 #include <unistd.h>
 #include <chrono>
+#include <csignal>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -17,6 +20,16 @@
 std::vector<User> newConnections;
 std::vector<User> lostConnections;
 
+// ticks of the main loop slower than this are logged with the time of each phase
+constexpr auto TICK_BUDGET = std::chrono::milliseconds(50);
+
+// set by SIGUSR1, the main loop then logs the profile of its ticks
+volatile std::sig_atomic_t profileRequested = 0;
+
+void onProfileRequest(int /*signal*/) {
+    profileRequested = 1;
+}
+
 void onConnect(User c) {
     std::cout << "New user: " << c.id << "\n";
     newConnections.push_back(c);
@@ -34,16 +47,32 @@ unsigned short getPort() {
     return 4040;
 }
 
-std::string getHTTPMessage(const char *htmlLocation) {
-    if (access(htmlLocation, R_OK) != -1) {
-        std::ifstream infile{htmlLocation};
-        return std::string{std::istreambuf_iterator<char>(infile),
-                           std::istreambuf_iterator<char>()};
-    } else {
-        LOG(ERROR) << "Unable to open HTML index file:\n"
-                   << htmlLocation << "\n";
-        std::exit(-1);
+std::string readFile(const std::filesystem::path& path) {
+    std::ifstream infile{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>(infile),
+                       std::istreambuf_iterator<char>()};
+}
+
+// serves a single html file as index.html, or every file of a directory at its relative path
+AssetBundle getAssets(const char *htmlLocation) {
+    std::error_code error;
+    if (std::filesystem::is_directory(htmlLocation, error)) {
+        AssetBundle assets;
+        for (auto& entry : std::filesystem::recursive_directory_iterator(htmlLocation, error)) {
+            if (entry.is_regular_file()) {
+                auto path = std::filesystem::relative(entry.path(), htmlLocation).generic_string();
+                assets.add("/" + path, readFile(entry.path()));
+            }
+        }
+        if (!error) {
+            return assets;
+        }
+    } else if (access(htmlLocation, R_OK) != -1) {
+        return AssetBundle{readFile(htmlLocation)};
     }
+    LOG(ERROR) << "Unable to open HTML index file:\n"
+               << htmlLocation << "\n";
+    std::exit(-1);
 }
 
 int main(int argc, char *argv[]) {    
@@ -51,8 +80,8 @@ int main(int argc, char *argv[]) {
     FLAGS_logtostderr = true;
     
     if (argc < 3) {
-        LOG(ERROR) << "Usage:\n  " << argv[0] << " port html_response\n"
-                   << "  e.g. " << argv[0] << " 4040 ./webchat.html\n";
+        LOG(ERROR) << "Usage:\n  " << argv[0] << " port html_response|asset_directory [compiled_game ...]\n"
+                   << "  e.g. " << argv[0] << " 4040 ./webchat.html ./lib/Rock_Paper_Scissors.so\n";
         return 1;
     }
     LOG(INFO) << "Setting up the server...";
@@ -63,35 +92,76 @@ int main(int argc, char *argv[]) {
 
     unsigned update_interval = 300;
     unsigned short port = std::stoi(argv[1]);
-    Server server{port, getHTTPMessage(argv[2]), onConnect, onDisconnect};
 
-    GlobalServerState globalState(update_interval);
+    // this thread runs the commands, spare cores go to network I/O first and then to the games
+    unsigned spare_cores = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    ServerOptions options;
+    options.ioThreads = std::min(1u, spare_cores);
+    unsigned worker_threads = spare_cores - options.ioThreads;
+    // game prompts and scores are repetitive text, compress them for clients that support it
+    options.compression.enabled = true;
+    Server server{port, getAssets(argv[2]), onConnect, onDisconnect, options};
+
+    // the games and commands are counted along with the connections, all served at /metrics
+    GlobalServerState globalState(update_interval, ExecutionLimits{}, worker_threads, LobbyLimits{}, &server.metrics());
+    for (int i = 3; i < argc; i++) {
+        if (!globalState.registerCompiledGame(argv[i])) {
+            LOG(ERROR) << "Falling back to interpreting the game json";
+        }
+    }
     CommandHandler commandHandler(globalState);
     MessageProcessor messageProcessor;
 
+    // every phase of the main loop is timed, the profile is logged on SIGUSR1
+    // and its histograms are served at /metrics
+    TickProfiler profiler{server.metrics(), TICK_BUDGET};
+    const size_t UPDATE = profiler.addPhase("server.update");
+    const size_t RECEIVE = profiler.addPhase("server.receive");
+    const size_t PROCESS_MESSAGES = profiler.addPhase("messageProcessor");
+    const size_t HANDLE_COMMANDS = profiler.addPhase("commandHandler");
+    const size_t SEND = profiler.addPhase("server.send");
+    const size_t PROCESS_GAMES = profiler.addPhase("processGames");
+    const size_t ADD_USERS = profiler.addPhase("addNewUsers");
+    const size_t LOST_USERS = profiler.addPhase("handleLostUsers");
+    std::signal(SIGUSR1, onProfileRequest);
+
     LOG(INFO) << "Game server is up!";
 
     // start listening for messages and serving content as appropriate
     while (true) {
+        profiler.beginTick();
         bool errorWhileUpdating = false;
         try {
-            server.update();
+            profiler.time(UPDATE, [&]() { server.update(); });
         } catch (std::exception &e) {
             LOG(ERROR) << "Exception from Server update:\n"
                        << " " << e.what() << std::endl;
             errorWhileUpdating = true;
         }
 
-        std::deque<ProcessedMessage> processedIncomingMessages = messageProcessor.getProcessedMessages(server.receive());
-        std::deque<Message> outgoingMsgs = commandHandler.getOutgoingMessages(processedIncomingMessages);
-        server.send(outgoingMsgs);
+        // the processed messages borrow their text from the incoming messages
+        std::deque<Message> incomingMsgs = profiler.time(RECEIVE, [&]() { return server.receive(); });
+        std::deque<ProcessedMessage> processedIncomingMessages = profiler.time(PROCESS_MESSAGES,
+            [&]() { return messageProcessor.getProcessedMessages(incomingMsgs); });
+        std::deque<Message> outgoingMsgs = profiler.time(HANDLE_COMMANDS,
+            [&]() { return commandHandler.getOutgoingMessages(processedIncomingMessages); });
+        profiler.time(SEND, [&]() { server.send(std::move(outgoingMsgs)); });
 
-        std::deque<Message> outgoingGameMsgs = globalState.processGames();
-        server.send(outgoingGameMsgs);
+        std::deque<Message> outgoingGameMsgs = profiler.time(PROCESS_GAMES, [&]() { return globalState.processGames(); });
+        profiler.time(SEND, [&]() { server.send(std::move(outgoingGameMsgs)); });
 
-        globalState.addNewUsers(newConnections);
-        std::deque<Message> outgoingDisconnectionMsgs = commandHandler.handleLostUsers(lostConnections);
-        server.send(outgoingDisconnectionMsgs);
+        profiler.time(ADD_USERS, [&]() { globalState.addNewUsers(newConnections); });
+        std::deque<Message> outgoingDisconnectionMsgs = profiler.time(LOST_USERS,
+            [&]() { return commandHandler.handleLostUsers(lostConnections); });
+        profiler.time(SEND, [&]() { server.send(std::move(outgoingDisconnectionMsgs)); });
+
+        if (profiler.endTick()) {
+            LOG(WARNING) << profiler.describeLastTick();
+        }
+        if (profileRequested) {
+            profileRequested = 0;
+            LOG(INFO) << "Tick profile:\n" << profiler.dump();
+        }
 
         if (errorWhileUpdating) {
             break;